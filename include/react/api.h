@@ -9,10 +9,15 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <string>
 #include <type_traits>
 #include <vector>
 
 #include "react/detail/defs.h"
+#include "react/common/completioncounter.h"
+#include "react/common/histogram.h"
 #include "react/common/utility.h"
 
 /*****************************************/ REACT_BEGIN /*****************************************/
@@ -27,15 +32,130 @@ enum class WeightHint
     heavy
 };
 
+enum class PropagationMode
+{
+    sequential,
+    level_parallel,
+    pulsecount,
+    subtree
+};
+
 enum class TransactionFlags
 {
     none            = 0,
     allow_merging   = 1 << 1,
-    sync_linked     = 1 << 2
+    sync_linked     = 1 << 2,
+
+    // Queued transactions of higher priority are always executed first.
+    high_priority   = 1 << 3,
+    low_priority    = 1 << 4,
+
+    // Never executed on the enqueueing thread, even if the group allows the caller to run it.
+    non_blocking    = 1 << 5
 };
 
 REACT_DEFINE_BITMASK_OPERATORS(TransactionFlags)
 
+/// What EnqueueTransaction does if the transaction queue is full.
+enum class QueueFullPolicy
+{
+    block,
+    fail,
+    drop_mergeable
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// NodeProfile
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// Update statistics of a single node. Only collected if REACT_ENABLE_PROFILING is defined.
+struct NodeProfile
+{
+    size_t      nodeId = 0;
+    std::string name;
+
+    uint64_t    updateCount     = 0;
+    uint64_t    changedCount    = 0;
+    uint64_t    unchangedCount  = 0;
+    uint64_t    shiftedCount    = 0;
+
+    std::chrono::nanoseconds updateTime { 0 };
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// TransactionStats
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// Statistics of the asynchronous transaction queue of a group. Times are in ns.
+struct TransactionStats
+{
+    // Time from EnqueueTransaction until the transaction starts executing.
+    HistogramSnapshot   enqueueLatency;
+
+    // Time of a turn, including all merged transactions and propagation.
+    HistogramSnapshot   executionTime;
+
+    // Number of transactions merged into a single turn.
+    HistogramSnapshot   mergeBatchSize;
+
+    // Number of queued transactions, sampled on each enqueue.
+    HistogramSnapshot   queueDepth;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// CoalescingPolicy
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// Controls how many transactions with allow_merging are executed in a single turn.
+struct CoalescingPolicy
+{
+    // Maximum number of transactions per turn. 0 means no limit.
+    size_t  maxBatchSize = 0;
+
+    // How long to wait for more mergeable transactions once the queue is empty.
+    std::chrono::microseconds linger { 0 };
+
+    // Start with single transactions and double the batch size each time a batch is filled up,
+    // up to maxBatchSize. Halve it when the queue runs empty early. Only lingers for batches
+    // of more than one transaction.
+    bool    isAdaptive = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// TransactionTicket
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// Returned by EnqueueTransaction. Refers to the completion counter of the queue the transaction
+/// was enqueued in, so it must not be used after its group has been destroyed.
+/// An invalid ticket means the transaction was rejected.
+class TransactionTicket
+{
+public:
+    TransactionTicket() = default;
+
+    TransactionTicket(const CompletionCounter* completedCount, size_t sequence) :
+        completedCount_( completedCount ),
+        sequence_( sequence )
+    { }
+
+    bool IsValid() const
+        { return completedCount_ != nullptr; }
+
+    explicit operator bool() const
+        { return IsValid(); }
+
+    /// True once the transaction and its propagation are done.
+    bool IsDone() const
+        { return completedCount_ == nullptr || completedCount_->Load() > sequence_; }
+
+    /// Blocks until the transaction is done. Must not be called from inside a transaction.
+    void Wait() const
+    {
+        if (completedCount_ != nullptr)
+            completedCount_->WaitUntilAbove(sequence_);
+    }
+
+private:
+    const CompletionCounter*    completedCount_ = nullptr;
+    size_t                      sequence_ = 0;
+};
+
 enum class Token { value };
 
 enum class InPlaceTag
@@ -0,0 +1,86 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef REACT_COMMON_COMPLETIONCOUNTER_H_INCLUDED
+#define REACT_COMMON_COMPLETIONCOUNTER_H_INCLUDED
+
+#pragma once
+
+#include "react/detail/defs.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+/*****************************************/ REACT_BEGIN /*****************************************/
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// CompletionCounter
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// Number of completed transactions of a queue lane. Waiters spin briefly, then block.
+/// Like SyncPoint, the mutex is only used by waiters and by the update that wakes them up.
+class CompletionCounter
+{
+public:
+    size_t Load() const
+        { return count_.load(); }
+
+    void Add(size_t n)
+    {
+        count_.fetch_add(n);
+
+        // Pairs with the increment of waiterCount_ in WaitUntilAbove. Either the waiter sees the new
+        // count, or this sees the waiter.
+        if (waiterCount_.load() == 0)
+            return;
+
+        {// mutex_
+            std::lock_guard<std::mutex> scopedLock(mtx_);
+        }// ~mutex_
+
+        cv_.notify_all();
+    }
+
+    /// Blocks until the count is greater than value.
+    void WaitUntilAbove(size_t value) const
+    {
+        for (int i = 0; i < spin_count; ++i)
+        {
+            if (Load() > value)
+                return;
+
+            std::this_thread::yield();
+        }
+
+        waiterCount_.fetch_add(1);
+
+        {// mutex_
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [&] { return Load() > value; });
+        }// ~mutex_
+
+        waiterCount_.fetch_sub(1);
+    }
+
+    /// Must not be called while there are waiters.
+    void Reset()
+        { count_.store(0, std::memory_order_relaxed); }
+
+private:
+    // Short transactions are usually done before it's worth blocking.
+    static const int spin_count = 64;
+
+    std::atomic<size_t>             count_{ 0 };
+    mutable std::atomic<int>        waiterCount_{ 0 };
+
+    mutable std::mutex              mtx_;
+    mutable std::condition_variable cv_;
+};
+
+/******************************************/ REACT_END /******************************************/
+
+#endif // REACT_COMMON_COMPLETIONCOUNTER_H_INCLUDED
@@ -0,0 +1,158 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef REACT_COMMON_HISTOGRAM_H_INCLUDED
+#define REACT_COMMON_HISTOGRAM_H_INCLUDED
+
+#pragma once
+
+#include "react/detail/defs.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/*****************************************/ REACT_BEGIN /*****************************************/
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// HistogramSnapshot
+/// Copy of the non-empty buckets of a histogram. Each bucket is stored as (upper bound, count).
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct HistogramSnapshot
+{
+    uint64_t    count   = 0;
+    uint64_t    sum     = 0;
+    uint64_t    min     = 0;
+    uint64_t    max     = 0;
+
+    std::vector<std::pair<uint64_t, uint64_t>> buckets;
+
+    double Mean() const
+        { return count != 0 ? static_cast<double>(sum) / count : 0.0; }
+
+    /// Upper bound of the bucket that contains the given percentile (0 - 100).
+    uint64_t Percentile(double p) const
+    {
+        uint64_t target = static_cast<uint64_t>(p / 100.0 * count + 0.5);
+        uint64_t seen = 0;
+
+        if (target == 0)
+            return min;
+
+        for (const auto& b : buckets)
+        {
+            seen += b.second;
+
+            if (seen >= target)
+                return (std::min)(b.first, max);
+        }
+
+        return max;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// Histogram
+/// Log-linear histogram in the style of HdrHistogram. Each power-of-two range is split into
+/// sub_bucket_count linear buckets, so the relative error is below 1 / sub_bucket_count.
+/// Recording is lock-free and can be done from multiple threads.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class Histogram
+{
+    static const uint sub_bucket_bits   = 3;
+    static const uint sub_bucket_count  = 1u << sub_bucket_bits;
+    static const uint bucket_count      = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+public:
+    void Record(uint64_t value)
+    {
+        buckets_[IndexOf(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t curMin = min_.load(std::memory_order_relaxed);
+        while (value < curMin && ! min_.compare_exchange_weak(curMin, value, std::memory_order_relaxed))
+            ;
+
+        uint64_t curMax = max_.load(std::memory_order_relaxed);
+        while (value > curMax && ! max_.compare_exchange_weak(curMax, value, std::memory_order_relaxed))
+            ;
+    }
+
+    /// Not atomic with respect to concurrent recording, but every bucket is read atomically.
+    HistogramSnapshot Snapshot() const
+    {
+        HistogramSnapshot result;
+
+        for (uint i = 0; i < bucket_count; ++i)
+        {
+            uint64_t c = buckets_[i].load(std::memory_order_relaxed);
+
+            if (c == 0)
+                continue;
+
+            result.buckets.emplace_back(UpperBoundOf(i), c);
+            result.count += c;
+        }
+
+        if (result.count != 0)
+        {
+            result.sum = sum_.load(std::memory_order_relaxed);
+            result.min = min_.load(std::memory_order_relaxed);
+            result.max = max_.load(std::memory_order_relaxed);
+        }
+
+        return result;
+    }
+
+    void Reset()
+    {
+        for (auto& b : buckets_)
+            b.store(0, std::memory_order_relaxed);
+
+        sum_.store(0, std::memory_order_relaxed);
+        min_.store((std::numeric_limits<uint64_t>::max)(), std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static uint IndexOf(uint64_t value)
+    {
+        // Values below sub_bucket_count are stored exactly.
+        if (value < sub_bucket_count)
+            return static_cast<uint>(value);
+
+        uint msb = 63;
+        while ((value >> msb) == 0)
+            --msb;
+
+        uint shift = msb - sub_bucket_bits;
+        return (shift + 1) * sub_bucket_count + static_cast<uint>((value >> shift) - sub_bucket_count);
+    }
+
+    static uint64_t UpperBoundOf(uint index)
+    {
+        if (index < sub_bucket_count)
+            return index;
+
+        uint shift = index / sub_bucket_count - 1;
+        uint64_t lower = static_cast<uint64_t>(sub_bucket_count + index % sub_bucket_count) << shift;
+
+        return lower + ((uint64_t(1) << shift) - 1);
+    }
+
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_ = { };
+
+    std::atomic<uint64_t> sum_{ 0 };
+    std::atomic<uint64_t> min_{ (std::numeric_limits<uint64_t>::max)() };
+    std::atomic<uint64_t> max_{ 0 };
+};
+
+/******************************************/ REACT_END /******************************************/
+
+#endif // REACT_COMMON_HISTOGRAM_H_INCLUDED
@@ -0,0 +1,93 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef REACT_COMMON_NODEBUFFER_H_INCLUDED
+#define REACT_COMMON_NODEBUFFER_H_INCLUDED
+
+#pragma once
+
+#include "react/detail/defs.h"
+
+#include <array>
+#include <cassert>
+
+/***************************************/ REACT_IMPL_BEGIN /**************************************/
+
+struct SplitTag { };
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// A fixed-capacity double-ended buffer of nodes, used as the work list of propagation tasks.
+/// If a task fills its buffer, it splits off half of the nodes to a new task.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename T, size_t N>
+class NodeBuffer
+{
+public:
+    NodeBuffer() = default;
+
+    NodeBuffer(const NodeBuffer&) = default;
+    NodeBuffer& operator=(const NodeBuffer&) = default;
+
+    explicit NodeBuffer(T value)
+        { PushBack(value); }
+
+    template <typename TIt>
+    NodeBuffer(TIt first, TIt last)
+    {
+        for (; first != last; ++first)
+            PushBack(*first);
+    }
+
+    /// Moves the front half of other into the new buffer.
+    NodeBuffer(NodeBuffer& other, SplitTag)
+    {
+        size_t count = other.size_ / 2;
+
+        for (size_t i = 0; i < count; ++i)
+            PushBack(other.PopFront());
+    }
+
+    void PushBack(T value)
+    {
+        assert(! IsFull());
+        data_[(front_ + size_) % N] = value;
+        ++size_;
+    }
+
+    T PopFront()
+    {
+        assert(! IsEmpty());
+        T value = data_[front_];
+        front_ = (front_ + 1) % N;
+        --size_;
+        return value;
+    }
+
+    T PopBack()
+    {
+        assert(! IsEmpty());
+        --size_;
+        return data_[(front_ + size_) % N];
+    }
+
+    bool IsEmpty() const
+        { return size_ == 0; }
+
+    bool IsFull() const
+        { return size_ == N; }
+
+    size_t Size() const
+        { return size_; }
+
+private:
+    std::array<T, N> data_;
+
+    size_t front_   = 0;
+    size_t size_    = 0;
+};
+
+/****************************************/ REACT_IMPL_END /***************************************/
+
+#endif // REACT_COMMON_NODEBUFFER_H_INCLUDED
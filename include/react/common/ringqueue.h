@@ -0,0 +1,158 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef REACT_COMMON_RINGQUEUE_H_INCLUDED
+#define REACT_COMMON_RINGQUEUE_H_INCLUDED
+
+#pragma once
+
+#include "react/detail/defs.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/***************************************/ REACT_IMPL_BEGIN /**************************************/
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// RingQueue
+/// Bounded lock-free queue for multiple producers and a single consumer.
+/// Every slot has a sequence number that tells whether it's ready to be written or read, so
+/// producers only contend on the write position and nothing is allocated after construction.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+class RingQueue
+{
+public:
+    /// Capacity is rounded up to the next power of two.
+    explicit RingQueue(size_t capacity = 1)
+        { Reset(capacity); }
+
+    RingQueue(const RingQueue&) = delete;
+    RingQueue& operator=(const RingQueue&) = delete;
+
+    /// Moves from value only if it was pushed. Returns false if the queue is full.
+    bool TryPush(T&& value)
+    {
+        size_t pos;
+        return TryPush(std::move(value), pos);
+    }
+
+    /// Also returns the position of the pushed value, i.e. the number of values pushed before it
+    /// since the last reset.
+    bool TryPush(T&& value, size_t& pos)
+    {
+        pos = writePos_.load(std::memory_order_relaxed);
+        Slot* slot;
+
+        for (;;)
+        {
+            slot = &slots_[pos & mask_];
+
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0)
+            {
+                if (writePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds a value from the previous round.
+                return false;
+            }
+            else
+            {
+                pos = writePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->value = std::move(value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /// Consumer only. Returns false if the queue is empty, or if the next value is still being written.
+    bool TryPop(T& value)
+    {
+        Slot& slot = slots_[readPos_ & mask_];
+
+        if (slot.sequence.load(std::memory_order_acquire) != readPos_ + 1)
+            return false;
+
+        value = std::move(slot.value);
+        slot.sequence.store(readPos_ + mask_ + 1, std::memory_order_release);
+
+        ++readPos_;
+
+        return true;
+    }
+
+    /// Consumer only. Returns the next value without popping it, or nullptr if there is none.
+    const T* Peek() const
+    {
+        const Slot& slot = slots_[readPos_ & mask_];
+
+        if (slot.sequence.load(std::memory_order_acquire) != readPos_ + 1)
+            return nullptr;
+
+        return &slot.value;
+    }
+
+    /// Consumer only.
+    bool IsEmpty() const
+        { return slots_[readPos_ & mask_].sequence.load(std::memory_order_acquire) != readPos_ + 1; }
+
+    size_t Capacity() const
+        { return mask_ + 1; }
+
+    /// Number of values that have been pushed since the last reset.
+    size_t WritePosition() const
+        { return writePos_.load(std::memory_order_relaxed); }
+
+    /// Consumer only. Number of values that have been popped since the last reset.
+    size_t ReadPosition() const
+        { return readPos_; }
+
+    /// Discards all values. Must not be called concurrently to push or pop.
+    void Reset(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        slots_.reset(new Slot[size]);
+        mask_ = size - 1;
+
+        for (size_t i = 0; i < size; ++i)
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+
+        writePos_.store(0, std::memory_order_relaxed);
+        readPos_ = 0;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t                  mask_ = 0;
+
+    // Keep the positions of producers and consumer on separate cache lines.
+    char padding1_[64];
+    std::atomic<size_t> writePos_{ 0 };
+    char padding2_[64];
+    size_t readPos_ = 0;
+};
+
+/****************************************/ REACT_IMPL_END /***************************************/
+
+#endif // REACT_COMMON_RINGQUEUE_H_INCLUDED
@@ -70,11 +70,9 @@ public:
 
     void Erase(size_t index)
     {
-        // If we erased something other than the last element, save in free index list.
-        if (index != (size_ - 1))
-        {
-            freeIndices_[freeSize_++] = index;
-        }
+        // Always save in free index list. Slots above index might still be in use, so the
+        // back can't just be shrunk.
+        freeIndices_[freeSize_++] = index;
 
         reinterpret_cast<T&>(data_[index]).~T();
         --size_;
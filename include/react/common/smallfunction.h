@@ -0,0 +1,168 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef REACT_COMMON_SMALLFUNCTION_H_INCLUDED
+#define REACT_COMMON_SMALLFUNCTION_H_INCLUDED
+
+#pragma once
+
+#include "react/detail/defs.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/***************************************/ REACT_IMPL_BEGIN /**************************************/
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// SmallFunction
+/// Move-only replacement for std::function<void()>. Callables of up to N bytes are stored inline,
+/// larger ones fall back to the heap.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+template <size_t N>
+class SmallFunction
+{
+public:
+    SmallFunction() = default;
+
+    template
+    <
+        typename F,
+        typename = typename std::enable_if<! std::is_same<typename std::decay<F>::type, SmallFunction>::value>::type
+    >
+    SmallFunction(F&& func)
+    {
+        using FuncType = typename std::decay<F>::type;
+        using OpsType = typename std::conditional<IsInline<FuncType>(), InlineOps<FuncType>, HeapOps<FuncType>>::type;
+
+        OpsType::Construct(&storage_, std::forward<F>(func));
+        ops_ = &OpsType::table;
+    }
+
+    SmallFunction(SmallFunction&& other) noexcept
+    {
+        if (other.ops_ != nullptr)
+        {
+            other.ops_->move(&storage_, &other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    SmallFunction& operator=(SmallFunction&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+
+            if (other.ops_ != nullptr)
+            {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+
+        return *this;
+    }
+
+    SmallFunction(const SmallFunction&) = delete;
+    SmallFunction& operator=(const SmallFunction&) = delete;
+
+    ~SmallFunction()
+        { Reset(); }
+
+    void operator()()
+        { ops_->invoke(&storage_); }
+
+    explicit operator bool() const
+        { return ops_ != nullptr; }
+
+    void Reset()
+    {
+        if (ops_ != nullptr)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    using StorageType = typename std::aligned_storage<N, alignof(std::max_align_t)>::type;
+
+    struct Ops
+    {
+        void (*invoke)(void*);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void*);
+    };
+
+    template <typename F>
+    static constexpr bool IsInline()
+    {
+        return sizeof(F) <= N
+            && alignof(std::max_align_t) % alignof(F) == 0
+            && std::is_nothrow_move_constructible<F>::value;
+    }
+
+    template <typename F>
+    struct InlineOps
+    {
+        template <typename T>
+        static void Construct(void* p, T&& func)
+            { new (p) F(std::forward<T>(func)); }
+
+        static void Invoke(void* p)
+            { (*static_cast<F*>(p))(); }
+
+        static void Move(void* dst, void* src)
+        {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+
+        static void Destroy(void* p)
+            { static_cast<F*>(p)->~F(); }
+
+        static const Ops table;
+    };
+
+    template <typename F>
+    struct HeapOps
+    {
+        template <typename T>
+        static void Construct(void* p, T&& func)
+            { *static_cast<F**>(p) = new F(std::forward<T>(func)); }
+
+        static void Invoke(void* p)
+            { (**static_cast<F**>(p))(); }
+
+        static void Move(void* dst, void* src)
+            { *static_cast<F**>(dst) = *static_cast<F**>(src); }
+
+        static void Destroy(void* p)
+            { delete *static_cast<F**>(p); }
+
+        static const Ops table;
+    };
+
+    StorageType storage_;
+    const Ops*  ops_ = nullptr;
+};
+
+template <size_t N>
+template <typename F>
+const typename SmallFunction<N>::Ops SmallFunction<N>::InlineOps<F>::table =
+    { &InlineOps<F>::Invoke, &InlineOps<F>::Move, &InlineOps<F>::Destroy };
+
+template <size_t N>
+template <typename F>
+const typename SmallFunction<N>::Ops SmallFunction<N>::HeapOps<F>::table =
+    { &HeapOps<F>::Invoke, &HeapOps<F>::Move, &HeapOps<F>::Destroy };
+
+/****************************************/ REACT_IMPL_END /***************************************/
+
+#endif // REACT_COMMON_SMALLFUNCTION_H_INCLUDED
@@ -12,9 +12,11 @@
 #include "react/detail/defs.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <iterator>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -39,77 +41,204 @@ public:
     class Dependency;
 
 private:
-    class ISyncTarget
+    // The wait count is atomic, so adding and releasing dependencies never locks.
+    // The mutex is only used by waiters, and by the release that wakes them up.
+    class SyncPointState
     {
     public:
-        virtual ~ISyncTarget() = default;
+        void IncrementWaitCount()
+            { waitCount_.fetch_add(1, std::memory_order_relaxed); }
 
-        virtual void IncrementWaitCount() = 0;
-        
-        virtual void DecrementWaitCount() = 0;
-    };
+        void DecrementWaitCount()
+        {
+            if (waitCount_.fetch_sub(1) != 1)
+                return;
 
-    class SyncPointState : public ISyncTarget
-    {
-    public:
-        virtual void IncrementWaitCount() override
-        {// mutex_
-            std::lock_guard<std::mutex> scopedLock(mtx_);
-            ++waitCount_;
-        }// ~mutex_
+            // Pairs with the increment of waiterCount_ in BlockUntil. Either the waiter sees the count
+            // reach zero, or this sees the waiter.
+            if (waiterCount_.load() == 0)
+                return;
 
-        virtual void DecrementWaitCount() override
-        {// mutex_
-            std::lock_guard<std::mutex> scopedLock(mtx_);
-            --waitCount_;
+            {// mutex_
+                std::lock_guard<std::mutex> scopedLock(mtx_);
+            }// ~mutex_
 
-            if (waitCount_ == 0)
-                cv_.notify_all();
-        }// ~mutex_
+            cv_.notify_all();
+        }
 
         void Wait()
         {
-            std::unique_lock<std::mutex> lock(mtx_);
-            cv_.wait(lock, [this] { return waitCount_ == 0; });
+            BlockUntil([this] (std::unique_lock<std::mutex>& lock)
+                {
+                    cv_.wait(lock, [this] { return IsDone(); });
+                    return true;
+                });
         }
-        
+
         template <typename TRep, typename TPeriod>
         bool WaitFor(const std::chrono::duration<TRep, TPeriod>& relTime)
         {
-            std::unique_lock<std::mutex> lock(mtx_);
-            return cv_.wait_for(lock, relTime, [this] { return waitCount_ == 0; });
+            return BlockUntil([&] (std::unique_lock<std::mutex>& lock)
+                {
+                    return cv_.wait_for(lock, relTime, [this] { return IsDone(); });
+                });
         }
 
         template <typename TRep, typename TPeriod>
         bool WaitUntil(const std::chrono::duration<TRep, TPeriod>& relTime)
         {
-            std::unique_lock<std::mutex> lock(mtx_);
-            return cv_.wait_until(lock, relTime, [this] { return waitCount_ == 0; });
+            return BlockUntil([&] (std::unique_lock<std::mutex>& lock)
+                {
+                    return cv_.wait_until(lock, relTime, [this] { return IsDone(); });
+                });
         }
 
     private:
+        bool IsDone() const
+            { return waitCount_.load() == 0; }
+
+        template <typename F>
+        bool BlockUntil(F&& waitFunc)
+        {
+            // Fast path. Nothing to wait for.
+            if (IsDone())
+                return true;
+
+            waiterCount_.fetch_add(1);
+
+            bool result;
+
+            {// mutex_
+                std::unique_lock<std::mutex> lock(mtx_);
+                result = waitFunc(lock);
+            }// ~mutex_
+
+            waiterCount_.fetch_sub(1);
+
+            return result;
+        }
+
+        std::atomic<int>        waitCount_{ 0 };
+        std::atomic<int>        waiterCount_{ 0 };
+
         std::mutex              mtx_;
         std::condition_variable cv_;
-
-        int waitCount_ = 0;
     };
 
-    class SyncTargetCollection : public ISyncTarget
+    // Dependency on multiple sync points. Nested collections are flattened and duplicates removed,
+    // so every target is a distinct sync point state.
+    // Collections are reference counted intrusively and recycled through a pool that is shared by
+    // all threads, since they are usually released by another group's worker than the one that
+    // merged them. Their target vectors keep their capacity, so merging doesn't allocate once the
+    // pool is warm.
+    class SyncTargetCollection
     {
     public:
-        virtual void IncrementWaitCount() override
+        static SyncTargetCollection* Create()
+        {
+            Pool& pool = GetPool();
+
+            {// mutex_
+                std::lock_guard<std::mutex> scopedLock(pool.mtx);
+
+                if (pool.head != nullptr)
+                {
+                    SyncTargetCollection* p = pool.head;
+                    pool.head = p->nextFree_;
+                    --pool.size;
+
+                    p->refCount_.store(1, std::memory_order_relaxed);
+                    return p;
+                }
+
+                ++pool.allocationCount;
+            }// ~mutex_
+
+            return new SyncTargetCollection();
+        }
+
+        static size_t GetAllocationCount()
+        {
+            Pool& pool = GetPool();
+
+            std::lock_guard<std::mutex> scopedLock(pool.mtx);
+            return pool.allocationCount;
+        }
+
+        void AddRef()
+            { refCount_.fetch_add(1, std::memory_order_relaxed); }
+
+        void RemoveRef()
+        {
+            if (refCount_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                Recycle(this);
+        }
+
+        void IncrementWaitCount()
         {
             for (const auto& e : targets)
                 e->IncrementWaitCount();
         }
 
-        virtual void DecrementWaitCount() override
+        void DecrementWaitCount()
         {
             for (const auto& e : targets)
                 e->DecrementWaitCount();
         }
 
-        std::vector<std::shared_ptr<ISyncTarget>> targets;
+        /// Sorts targets and removes duplicates.
+        void Normalize()
+        {
+            auto less = [] (const std::shared_ptr<SyncPointState>& a, const std::shared_ptr<SyncPointState>& b)
+                { return a.get() < b.get(); };
+
+            std::sort(targets.begin(), targets.end(), less);
+            targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+        }
+
+        std::vector<std::shared_ptr<SyncPointState>> targets;
+
+    private:
+        static const size_t max_pool_size = 64;
+
+        struct Pool
+        {
+            std::mutex              mtx;
+            SyncTargetCollection*   head = nullptr;
+            size_t                  size = 0;
+            size_t                  allocationCount = 0;
+        };
+
+        static Pool& GetPool()
+        {
+            // Never destroyed, so dependencies can still be released during static destruction.
+            static Pool* pool = new Pool();
+            return *pool;
+        }
+
+        static void Recycle(SyncTargetCollection* p)
+        {
+            p->targets.clear();
+
+            Pool& pool = GetPool();
+
+            {// mutex_
+                std::lock_guard<std::mutex> scopedLock(pool.mtx);
+
+                if (pool.size < max_pool_size)
+                {
+                    p->nextFree_ = pool.head;
+                    pool.head = p;
+                    ++pool.size;
+                    return;
+                }
+            }// ~mutex_
+
+            delete p;
+        }
+
+        std::atomic<int>        refCount_{ 1 };
+        SyncTargetCollection*   nextFree_ = nullptr;
     };
 
 public:
@@ -146,6 +275,13 @@ public:
         return state_->WaitUntil(relTime);
     }
 
+    /// Number of collections that merged dependencies have allocated so far. Released collections
+    /// are reused, so this stops growing once enough of them are in circulation.
+    static size_t GetCollectionAllocationCount()
+    {
+        return SyncTargetCollection::GetAllocationCount();
+    }
+
     /// A RAII-style token object that represents a dependency of a SyncPoint.
     class Dependency
     {
@@ -155,13 +291,14 @@ public:
 
         /// Constructs a single dependency for a sync point.
         explicit Dependency(const SyncPoint& sp) :
-            target_( sp.state_ )
+            state_( sp.state_ )
         {
-            target_->IncrementWaitCount();
+            state_->IncrementWaitCount();
         }
 
         /// Merges an input range of other dependencies into a single dependency.
-        /// This allows to create APIs that are agnostic of how many dependent operations they process.        
+        /// This allows to create APIs that are agnostic of how many dependent operations they process.
+        /// Each distinct sync point is only counted once.
         template <typename TBegin, typename TEnd>
         Dependency(TBegin first, TEnd last)
         {
@@ -169,84 +306,136 @@ public:
 
             if (count == 1)
             {
-                target_ = first->target_;
-                if (target_)
-                    target_->IncrementWaitCount();
+                state_ = first->state_;
+                collection_ = first->collection_;
+
+                if (collection_)
+                    collection_->AddRef();
+
+                Increment();
             }
             else if (count > 1)
             {
-                auto collection = std::make_shared<SyncTargetCollection>();
-                collection->targets.reserve(count);
+                SyncTargetCollection* collection = SyncTargetCollection::Create();
             
+                // There's no point in propagating released/empty dependencies.
                 for (; !(first == last); ++first)
-                    if (first->target_) // There's no point in propagating released/empty dependencies.
-                        collection->targets.push_back(first->target_);
-
-                collection->IncrementWaitCount();
-
-                target_ = std::move(collection);
+                {
+                    if (first->state_)
+                        collection->targets.push_back(first->state_);
+                    else if (first->collection_)
+                        collection->targets.insert(collection->targets.end(),
+                            first->collection_->targets.begin(), first->collection_->targets.end());
+                }
+
+                collection->Normalize();
+
+                // Only a single sync point left? Then the collection isn't needed.
+                if (collection->targets.size() == 1)
+                    state_ = collection->targets.front();
+                else if (! collection->targets.empty())
+                    collection_ = collection;
+
+                if (collection_ == nullptr)
+                    collection->RemoveRef();
+
+                Increment();
             }
         }
 
         /// Copy constructor and assignment split a dependency.
         /// The new dependency that has the same target(s) as other.
         Dependency(const Dependency& other) :
-            target_( other.target_ )
+            state_( other.state_ ),
+            collection_( other.collection_ )
         {
-            if (target_)
-                target_->IncrementWaitCount();
+            if (collection_)
+                collection_->AddRef();
+
+            Increment();
         }
 
         Dependency& operator=(const Dependency& other)
         {
-            if (other.target_)
-                other.target_->IncrementWaitCount();
+            if (this == &other)
+                return *this;
 
-            if (target_)
-                target_->DecrementWaitCount();
+            if (other.collection_)
+                other.collection_->AddRef();
 
-            target_ = other.target_;
+            other.Increment();
+            Reset();
+
+            state_ = other.state_;
+            collection_ = other.collection_;
             return *this;
         }
 
         /// Move constructor and assignment transfer a dependency.
         /// The moved from object is left unbound.
-        Dependency(Dependency&& other) :
-            target_( std::move(other.target_) )
-        { }
+        Dependency(Dependency&& other) noexcept :
+            state_( std::move(other.state_) ),
+            collection_( other.collection_ )
+        {
+            other.collection_ = nullptr;
+        }
 
-        Dependency& operator=(Dependency&& other)
+        Dependency& operator=(Dependency&& other) noexcept
         {
-            if (target_)
-                target_->DecrementWaitCount();
+            if (this == &other)
+                return *this;
+
+            Reset();
 
-            target_ = std::move(other.target_);
+            state_ = std::move(other.state_);
+            collection_ = other.collection_;
+            other.collection_ = nullptr;
             return *this;
         }
 
         /// The destructor releases a dependency, if it's not unbound.
         ~Dependency()
         {
-            if (target_)
-                target_->DecrementWaitCount();
+            Reset();
         }
 
         /// Manually releases the dependency. Afterwards it is unbound.
         void Release()
         {
-            if (target_)
-            {
-                target_->DecrementWaitCount();
-                target_ = nullptr;
-            }
+            Reset();
         }
 
         /// Returns if a dependency is released, i.e. if it is unbound.
         bool IsReleased() const
-            { return target_ == nullptr; }
+            { return state_ == nullptr && collection_ == nullptr; }
 
     private:
-        std::shared_ptr<ISyncTarget> target_;
+        void Increment() const
+        {
+            if (state_)
+                state_->IncrementWaitCount();
+            else if (collection_)
+                collection_->IncrementWaitCount();
+        }
+
+        void Reset()
+        {
+            if (state_)
+            {
+                state_->DecrementWaitCount();
+                state_ = nullptr;
+            }
+            else if (collection_)
+            {
+                collection_->DecrementWaitCount();
+                collection_->RemoveRef();
+                collection_ = nullptr;
+            }
+        }
+
+        // A single sync point is the common case, so it's referenced directly.
+        std::shared_ptr<SyncPointState> state_;
+        SyncTargetCollection*           collection_ = nullptr;
     };
 
 private:
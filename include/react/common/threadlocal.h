@@ -0,0 +1,119 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef REACT_COMMON_THREADLOCAL_H_INCLUDED
+#define REACT_COMMON_THREADLOCAL_H_INCLUDED
+
+#pragma once
+
+#include "react/detail/defs.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#ifndef REACT_DISABLE_TBB
+#include <tbb/enumerable_thread_specific.h>
+#endif
+
+/***************************************/ REACT_IMPL_BEGIN /**************************************/
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// ThreadLocalStore
+/// One lazily constructed T per thread that calls local(). Iterating over the values is only
+/// safe while no thread is calling local().
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef REACT_DISABLE_TBB
+
+template <typename T>
+using ThreadLocalStore = tbb::enumerable_thread_specific<T>;
+
+#else
+
+template <typename T>
+class ThreadLocalStore
+{
+public:
+    using iterator = typename std::deque<T>::iterator;
+
+    ThreadLocalStore() :
+        id_( NextId() )
+    { }
+
+    ThreadLocalStore(const ThreadLocalStore&) = delete;
+    ThreadLocalStore& operator=(const ThreadLocalStore&) = delete;
+
+    T& local()
+    {
+        // Threads tend to use the same store repeatedly, so the last lookup is cached.
+        // Ids are never reused, so the cache can't refer to a destroyed store.
+        static thread_local Cache cache;
+
+        if (cache.id == id_)
+            return *cache.value;
+
+        std::thread::id threadId = std::this_thread::get_id();
+        T* value;
+
+        {// mutex_
+            std::lock_guard<std::mutex> scopedLock(mutex_);
+
+            auto it = lookup_.find(threadId);
+
+            if (it != lookup_.end())
+            {
+                value = it->second;
+            }
+            else
+            {
+                // Deque doesn't move its elements, so the pointers stay valid.
+                values_.emplace_back();
+                value = &values_.back();
+                lookup_.emplace(threadId, value);
+            }
+        }// ~mutex_
+
+        cache.id = id_;
+        cache.value = value;
+
+        return *value;
+    }
+
+    iterator begin()
+        { return values_.begin(); }
+
+    iterator end()
+        { return values_.end(); }
+
+private:
+    struct Cache
+    {
+        uint64_t    id = 0;
+        T*          value = nullptr;
+    };
+
+    static uint64_t NextId()
+    {
+        static std::atomic<uint64_t> nextId{ 1 };
+        return nextId.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const uint64_t id_;
+
+    std::mutex mutex_;
+
+    std::deque<T> values_;
+
+    std::unordered_map<std::thread::id, T*> lookup_;
+};
+
+#endif
+
+/****************************************/ REACT_IMPL_END /***************************************/
+
+#endif // REACT_COMMON_THREADLOCAL_H_INCLUDED
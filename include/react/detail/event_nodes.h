@@ -49,17 +49,71 @@ public:
         EventNode::NodeBase( group )
     { }
 
+    /// Buffer to write the events of the current turn to.
+    /// Events of previous turns are cleared lazily on first access in a new turn.
     EventValueList<E>& Events()
-        { return events_; }
+    {
+        TurnId turnId = this->GetGraphPtr()->GetCurrentTurnId();
+
+        if (turnId_ != turnId)
+        {
+            events_.clear();
+            sharedEvents_.reset();
+            turnId_ = turnId;
+        }
+        else if (sharedEvents_)
+        {
+            // Shared buffers are immutable, so writing to them requires a private copy.
+            events_ = *sharedEvents_;
+            sharedEvents_.reset();
+        }
+
+        return events_;
+    }
 
+    /// Events of the current turn. Doesn't modify the buffer, so it's safe to call concurrently.
     const EventValueList<E>& Events() const
-        { return events_; }
+    {
+        static const EventValueList<E> emptyList;
+
+        if (turnId_ != this->GetGraphPtr()->GetCurrentTurnId())
+            return emptyList;
+
+        if (sharedEvents_)
+            return *sharedEvents_;
+
+        return events_;
+    }
+
+    /// Moves the events of the current turn to an immutable, reference counted buffer, so they
+    /// can be handed to other groups without copying. Repeated calls return the same buffer.
+    std::shared_ptr<const EventValueList<E>> ShareEvents()
+    {
+        if (turnId_ != this->GetGraphPtr()->GetCurrentTurnId())
+            return std::make_shared<const EventValueList<E>>();
+
+        if (! sharedEvents_)
+        {
+            sharedEvents_ = std::make_shared<const EventValueList<E>>(std::move(events_));
+            events_.clear();
+        }
 
-    virtual void Clear() noexcept override
-        { events_.clear(); }
+        return sharedEvents_;
+    }
+
+    /// Uses a shared buffer as the events of the current turn.
+    void SetSharedEvents(std::shared_ptr<const EventValueList<E>>&& events)
+    {
+        Events();
+        sharedEvents_ = std::move(events);
+    }
 
 private:
     EventValueList<E> events_;
+
+    std::shared_ptr<const EventValueList<E>> sharedEvents_;
+
+    TurnId turnId_ = invalid_turn_id;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -105,6 +159,7 @@ public:
         inputs_( deps ... )
     {
         this->RegisterMe();
+        this->SetPrunable();
         REACT_EXPAND_PACK(this->AttachToMe(GetInternals(deps).GetNodeId()));
     }
 
@@ -234,6 +289,7 @@ public:
         dep_( dep )
     {
         this->RegisterMe();
+        this->SetPrunable();
         this->AttachToMe(GetInternals(dep).GetNodeId());
     }
 
@@ -274,6 +330,7 @@ public:
         syncHolder_( syncs ... )
     {
         this->RegisterMe();
+        this->SetPrunable();
         this->AttachToMe(GetInternals(dep).GetNodeId());
         REACT_EXPAND_PACK(this->AttachToMe(GetInternals(syncs).GetNodeId()));
     }
@@ -436,8 +493,8 @@ public:
     virtual UpdateResult Update(TurnId turnId) noexcept override
         { return UpdateResult::changed; }
 
-    void SetEvents(EventValueList<E>&& events)
-        { this->Events() = std::move(events); }
+    void SetEvents(std::shared_ptr<const EventValueList<E>>&& events)
+        { this->SetSharedEvents(std::move(events)); }
 
 private:
     struct VirtualOutputNode : public IReactNode
@@ -450,8 +507,12 @@ private:
             if (auto p = parent.lock())
             {
                 auto* rawPtr = p->GetGraphPtr().get();
+
+                // All links of the same source share one buffer.
+                auto events = GetInternals(p->dep_).GetNodePtr()->ShareEvents();
+
                 output[rawPtr].push_back(
-                    [storedParent = std::move(p), storedEvents = GetInternals(p->dep_).Events()] () mutable
+                    [storedParent = std::move(p), storedEvents = std::move(events)] () mutable
                     {
                         NodeId nodeId = storedParent->GetNodeId();
                         auto& graphPtr = storedParent->GetGraphPtr();
@@ -503,11 +564,9 @@ public:
     NodeId GetNodeId() const
         { return nodePtr_->GetNodeId(); }
 
-    EventValueList<E>& Events()
-        { return nodePtr_->Events(); }
-
+    // Read-only. Only the node itself writes to its buffer.
     const EventValueList<E>& Events() const
-        { return nodePtr_->Events(); }
+        { return static_cast<const EventNode<E>&>(*nodePtr_).Events(); }
 
 private:
     std::shared_ptr<EventNode<E>> nodePtr_;
@@ -13,77 +13,287 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
 #include <map>
 #include <mutex>
 
-#include <tbb/concurrent_queue.h>
-#include <tbb/task.h>
-
 #include "react/common/ptrcache.h"
+#include "react/common/ringqueue.h"
 #include "react/common/slotmap.h"
+#include "react/common/smallfunction.h"
 #include "react/common/syncpoint.h"
+#include "react/common/threadlocal.h"
+#include "react/executor.h"
+#include "react/detail/trace_sink.h"
 #include "react/detail/graph_interface.h"
 
 /***************************************/ REACT_IMPL_BEGIN /**************************************/
 
 class ReactGraph;
 
+namespace pulsecount {
+    class MarkerTask;
+    class UpdaterTask;
+}
+
+namespace subtree {
+    class UpdaterTask;
+}
+
 class TransactionQueue
 {
 public:
     TransactionQueue(ReactGraph& graph) :
+#ifndef REACT_DISABLE_TBB
+        executor_( std::make_shared<TbbExecutor>() ),
+#else
+        executor_( std::make_shared<ThreadPoolExecutor>() ),
+#endif
         graph_( graph )
-    { }
+    {
+        SetCapacity(default_capacity);
+    }
+
+    /// Returns an invalid ticket if the transaction was rejected because the queue is full.
+    template <typename F>
+    TransactionTicket Push(F&& func, SyncPoint::Dependency dep, TransactionFlags flags, QueueFullPolicy policy)
+    {
+        StoredTransaction transaction{ std::forward<F>(func), std::move(dep), flags, ClockType::now() };
+
+        size_t laneIndex = LaneOf(flags);
+        size_t sequence;
+
+        while (! lanes_[laneIndex].TryPush(std::move(transaction), sequence))
+        {
+            if (policy == QueueFullPolicy::fail)
+                return TransactionTicket{ };
+
+            if (policy == QueueFullPolicy::drop_mergeable && IsBitmaskSet(flags, TransactionFlags::allow_merging))
+                return TransactionTicket{ };
 
+            // The worker can't wait for itself.
+            if (workerThread_.load(std::memory_order_relaxed) == std::this_thread::get_id())
+                return TransactionTicket{ };
+
+            std::this_thread::yield();
+        }
+
+        size_t depth = count_.fetch_add(1, std::memory_order_acq_rel);
+
+        queueDepth_.Record(depth + 1);
+
+        if (depth == 0)
+        {
+            // The caller claimed the idle queue, so it can run the first turn itself.
+            if (isCallerRunsEnabled_ && ! IsBitmaskSet(flags, TransactionFlags::non_blocking))
+                ProcessQueue(ClockType::now());
+            else
+                PostWorker();
+        }
+
+        // Transactions of a lane are completed in the order they were pushed.
+        return TransactionTicket{ &completedCounts_[laneIndex], sequence };
+    }
+
+    /// Pushes the inputs of a link. They must not be lost, and the pushing thread can't wait,
+    /// because it still owns the source graph. If the lane is full, they spill into an unbounded
+    /// overflow list instead. Never runs inline.
     template <typename F>
-    void Push(F&& func, SyncPoint::Dependency dep, TransactionFlags flags)
+    void PushLinked(F&& func, SyncPoint::Dependency dep, TransactionFlags flags)
     {
-        transactions_.push(StoredTransaction{ std::forward<F>(func), std::move(dep), flags });
+        StoredTransaction transaction{ std::forward<F>(func), std::move(dep), flags, ClockType::now() };
+
+        size_t laneIndex = LaneOf(flags);
+
+        // Once something has spilled, the following inputs spill as well, so they stay in order.
+        if (overflows_[laneIndex].count.load(std::memory_order_acquire) != 0 || ! lanes_[laneIndex].TryPush(std::move(transaction)))
+            Spill(laneIndex, std::move(transaction));
+
+        size_t depth = count_.fetch_add(1, std::memory_order_acq_rel);
+
+        queueDepth_.Record(depth + 1);
 
-        if (count_.fetch_add(1, std::memory_order_release) == 0)
-            tbb::task::enqueue(*new(tbb::task::allocate_root()) WorkerTask(*this));
+        if (depth == 0)
+            PostWorker();
     }
 
+    QueueFullPolicy GetPolicy() const
+        { return policy_; }
+
+    /// Capacity of each priority lane. Must not be called while transactions are pending.
+    /// Invalidates existing tickets.
+    void SetCapacity(size_t capacity)
+    {
+        for (auto& lane : lanes_)
+            lane.Reset(capacity);
+
+        for (auto& count : completedCounts_)
+            count.Reset();
+
+        for (auto& overflow : overflows_)
+        {
+            overflow.pushedCount = 0;
+            overflow.completedCount.Reset();
+        }
+    }
+
+    void SetPolicy(QueueFullPolicy policy)
+        { policy_ = policy; }
+
+    /// Must not be called while transactions are pending.
+    void SetCoalescingPolicy(const CoalescingPolicy& policy)
+    {
+        coalescing_ = policy;
+        adaptiveBatchSize_ = 1;
+    }
+
+    /// Must not be called while transactions are pending.
+    void SetExecutor(std::shared_ptr<Executor> executor)
+        { executor_ = std::move(executor); }
+
+    /// Must not be called while transactions are pending.
+    void SetCallerRunsEnabled(bool enabled)
+        { isCallerRunsEnabled_ = enabled; }
+
+    TransactionStats GetStats() const;
+
+    void ResetStats();
+
+    /// Blocks until all transactions that were pushed before the call are done.
+    void WaitForPending();
+
 private:
+    using ClockType = std::chrono::steady_clock;
+
+    // Callables of up to this size are stored in the queue without allocating.
+    static const size_t transaction_buffer_size = 48;
+
+    static const size_t default_capacity = 256;
+
+    // High, normal and low priority.
+    static const size_t lane_count = 3;
+
+    // Upper bound of the adaptive batch size if the policy doesn't set one.
+    static const size_t max_adaptive_batch_size = 1024;
+
     struct StoredTransaction
     {
-        std::function<void()>   func;
-        SyncPoint::Dependency   dep;
-        TransactionFlags        flags;
+        SmallFunction<transaction_buffer_size>  func;
+        SyncPoint::Dependency                   dep;
+        TransactionFlags                        flags;
+        ClockType::time_point                   enqueueTime;
+
+        // Spilled transactions have no ticket, so they don't count as completed for the lane.
+        bool                                    isSpilled = false;
     };
 
-    class WorkerTask : public tbb::task
+    /// Linked transactions that didn't fit into their lane.
+    struct Overflow
     {
-    public:
-        WorkerTask(TransactionQueue& parent) :
-            parent_( parent )
-        { }
-
-        tbb::task* execute()
+        struct Entry
         {
-            parent_.ProcessQueue();
-            return nullptr;
-        }
+            // Write position of the lane when it spilled. Transactions pushed before go first.
+            size_t              position;
+            StoredTransaction   transaction;
+        };
 
-    private:
-        TransactionQueue& parent_;
+        std::mutex          mutex;
+        std::deque<Entry>   entries;
+        std::atomic<size_t> count{ 0 };
+
+        // Guarded by mutex.
+        size_t              pushedCount = 0;
+
+        CompletionCounter   completedCount;
     };
 
+    static size_t LaneOf(TransactionFlags flags)
+    {
+        if (IsBitmaskSet(flags, TransactionFlags::high_priority))
+            return 0;
+        else if (IsBitmaskSet(flags, TransactionFlags::low_priority))
+            return 2;
+        else
+            return 1;
+    }
+
+    /// The posted worker keeps the graph alive until it returns, since a transaction may release
+    /// the last reference to its group.
+    void PostWorker();
+
     void ProcessQueue();
 
-    size_t ProcessNextBatch();
+    /// Runs turns until the queue is empty. After the first turn that ends past the deadline,
+    /// the remaining work is posted to the executor instead.
+    void ProcessQueue(ClockType::time_point deadline);
+
+    /// Returns once the queue is empty, or after the first turn that ends past the deadline.
+    size_t ProcessNextBatch(ClockType::time_point deadline);
+
+    void Spill(size_t lane, StoredTransaction&& transaction);
+
+    bool TryPopNext(StoredTransaction& transaction, size_t& lane);
+
+    /// Pops from the overflow list once everything pushed to the lane before it has been popped.
+    bool TryPop(size_t lane, StoredTransaction& transaction);
+
+    /// Returns the transaction TryPop would return next, or nullptr.
+    const StoredTransaction* Peek(size_t lane);
+
+    bool IsEmpty(size_t lane) const;
+
+    bool HasWorkAbove(size_t lane) const;
 
-    tbb::concurrent_queue<StoredTransaction> transactions_;
+    bool HasMergeableWork(size_t lane);
+
+    size_t GetBatchLimit() const;
+
+    void AdaptBatchSize(size_t batchSize, bool isFull);
+
+    /// Waits until the lane has work or the deadline has passed. Returns false on timeout.
+    bool WaitForWork(size_t lane, ClockType::time_point deadline) const;
+
+    void RecordStart(const StoredTransaction& transaction);
+
+    RingQueue<StoredTransaction> lanes_[lane_count];
+
+    Overflow overflows_[lane_count];
+
+    // Number of completed transactions per lane. The sequence of a ticket is its position in the lane.
+    CompletionCounter completedCounts_[lane_count];
 
     std::atomic<size_t> count_{ 0 };
 
+    std::atomic<std::thread::id> workerThread_{ std::thread::id{ } };
+
+    QueueFullPolicy policy_ = QueueFullPolicy::block;
+
+    bool isCallerRunsEnabled_ = false;
+
+    std::shared_ptr<Executor> executor_;
+
+    CoalescingPolicy coalescing_;
+
+    // Only accessed by the worker.
+    size_t adaptiveBatchSize_ = 1;
+
+    Histogram   enqueueLatency_;
+    Histogram   executionTime_;
+    Histogram   mergeBatchSize_;
+    Histogram   queueDepth_;
+
     ReactGraph& graph_;
 };
 
-class ReactGraph
+class ReactGraph : public std::enable_shared_from_this<ReactGraph>
 {
 public:
     using LinkCache = WeakPtrCache<void*, IReactNode>;
@@ -94,6 +304,17 @@ public:
     void AttachNode(NodeId node, NodeId parentId);
     void DetachNode(NodeId node, NodeId parentId);
 
+    void SetNodeWeightHint(NodeId nodeId, WeightHint weight);
+
+    bool IsNodeHeavy(NodeId nodeId) const
+        { return nodeData_[nodeId].isHeavy; }
+
+    void SetNodeName(NodeId nodeId, std::string name);
+
+    /// Prunable nodes are skipped while no observer depends on them.
+    /// Must be set before the node is attached to anything.
+    void SetNodePrunable(NodeId nodeId);
+
     template <typename F>
     void PushInput(NodeId nodeId, F&& inputCallback);
 
@@ -101,77 +322,379 @@ public:
 
     void AllowLinkedTransactionMerging(bool allowMerging);
 
+    /// Without TBB, there are no parallel modes and everything is propagated sequentially.
+    void SetPropagationMode(PropagationMode mode)
+    {
+#ifndef REACT_DISABLE_TBB
+        propagationMode_ = mode;
+#endif
+    }
+
+    void SetPruningEnabled(bool enabled);
+
+    /// Allows inputs from multiple threads. Must not be changed while inputs are pending.
+    void SetConcurrentInputEnabled(bool enabled)
+        { isConcurrentInputEnabled_ = enabled; }
+
+    /// Read by the source groups of state links, so it can be changed at any time.
+    void SetStateLinkCoalescingEnabled(bool enabled)
+        { isStateLinkCoalescingEnabled_.store(enabled, std::memory_order_relaxed); }
+
+    bool IsStateLinkCoalescingEnabled() const
+        { return isStateLinkCoalescingEnabled_.load(std::memory_order_relaxed); }
+
+    /// True if the current turn releases sync points of linked transactions.
+    bool HasLinkDependencies() const
+        { return ! linkDependencies_.empty(); }
+
+    /// Profiles of all nodes. Empty if profiling is not enabled.
+    /// Must not be called while a transaction is in progress.
+    std::vector<NodeProfile> GetProfile() const;
+
+    void ResetProfile();
+
+    /// Records a trace of all following transactions, until StopTrace() writes it as
+    /// Chrome trace-event JSON. Does nothing if profiling is not enabled.
+    /// Must not be called while a transaction is in progress.
+    void StartTrace();
+    void StopTrace(std::ostream& out);
+
+#ifdef REACT_ENABLE_PROFILING
+    TraceSink& GetTraceSink()
+        { return traceSink_; }
+#endif
+
+    /// Id of the turn that is currently being prepared or propagated.
+    /// Incremented after each propagation.
+    TurnId GetCurrentTurnId() const
+        { return currentTurnId_; }
+
     template <typename F>
     void DoTransaction(F&& transactionCallback);
 
     template <typename F>
-    void EnqueueTransaction(F&& func, SyncPoint::Dependency dep, TransactionFlags flags);
+    TransactionTicket EnqueueTransaction(F&& func, SyncPoint::Dependency dep, TransactionFlags flags);
     
     LinkCache& GetLinkCache()
         { return linkCache_; }
 
+    TransactionQueue& GetTransactionQueue()
+        { return transactionQueue_; }
+
+    const TransactionQueue& GetTransactionQueue() const
+        { return transactionQueue_; }
+
 private:
+    friend class pulsecount::MarkerTask;
+    friend class pulsecount::UpdaterTask;
+    friend class subtree::UpdaterTask;
+
+    static constexpr uint   cost_sample_interval    = 8;
+    static constexpr float  heavy_cost_threshold    = 50000.0f;
+
+    /// Node marks used by the pulsecount and subtree engines.
+    enum class NodeMark : uchar
+    {
+        unmarked,
+        visited,
+        should_update
+    };
+
+    /// Data that is only needed once a node is actually updated.
+    /// Everything touched while scheduling is kept in separate arrays, indexed by node id.
     struct NodeData
     {
         NodeData() = default;
 
-        NodeData(const NodeData&) = default;
-        NodeData& operator=(const NodeData&) = default;
-
         NodeData(IReactNode* nodePtrIn, NodeCategory categoryIn) :
-            nodePtr( nodePtrIn ),
-            category(categoryIn)
+            category( categoryIn ),
+            nodePtr( nodePtrIn )
         { }
 
         NodeCategory category = NodeCategory::normal;
 
-        int     level       = 0;
-        int     newLevel    = 0 ;
-        bool    queued      = false;
+        // Heavy nodes are dispatched to worker threads, light nodes are updated inline.
+        // For automatic nodes, this is decided by the measured update cost.
+        WeightHint  weightHint  = WeightHint::automatic;
+        bool        isHeavy     = false;
+
+        bool isPrunable = false;
+
+        // Moving average of sampled update times in ns. Only used by automatic nodes.
+        uint    updateCount     = 0;
+        float   avgUpdateCost   = 0.0f;
 
         IReactNode*  nodePtr = nullptr;
+    };
+
+    /// Growable array of atomics. Unlike std::vector, it doesn't require movable elements.
+    /// Must not be resized concurrently to any access.
+    template <typename T>
+    class AtomicArray
+    {
+    public:
+        std::atomic<T>& operator[](size_t index)
+            { return data_[index]; }
+
+        const std::atomic<T>& operator[](size_t index) const
+            { return data_[index]; }
+
+        size_t Size() const
+            { return size_; }
+
+        void Resize(size_t newSize, T initialValue)
+        {
+            std::unique_ptr<std::atomic<T>[]> newData{ new std::atomic<T>[newSize] };
+
+            for (size_t i = 0; i < newSize; ++i)
+                newData[i].store(i < size_ ? data_[i].load(std::memory_order_relaxed) : initialValue, std::memory_order_relaxed);
+
+            data_ = std::move(newData);
+            size_ = newSize;
+        }
+
+    private:
+        std::unique_ptr<std::atomic<T>[]>   data_;
+        size_t                              size_ = 0;
+    };
 
-        std::vector<NodeId> successors;
+    /// Iterable view of the successors or predecessors of a node.
+    class AdjacencyRange
+    {
+    public:
+        AdjacencyRange(const NodeId* first, const NodeId* last) :
+            first_( first ),
+            last_( last )
+        { }
+
+        const NodeId* begin() const
+            { return first_; }
+
+        const NodeId* end() const
+            { return last_; }
+
+    private:
+        const NodeId* first_;
+        const NodeId* last_;
     };
 
+    /// Adjacency lists of all nodes, stored in a single contiguous arena (CSR).
+    /// Each node owns a slice with some slack. A full slice is moved to the end of the arena with
+    /// twice the capacity, and the arena is compacted once most of it is unused.
+    /// Ranges are invalidated by Add.
+    class AdjacencyArena
+    {
+    public:
+        void Register(NodeId nodeId);
+        void Unregister(NodeId nodeId);
+
+        void Add(NodeId nodeId, NodeId succId);
+        void Remove(NodeId nodeId, NodeId succId);
+
+        AdjacencyRange Get(NodeId nodeId) const
+        {
+            const Slice& s = slices_[nodeId];
+            const NodeId* first = data_.data() + s.offset;
+            return AdjacencyRange( first, first + s.count );
+        }
+
+    private:
+        struct Slice
+        {
+            size_t  offset      = 0;
+            uint    count       = 0;
+            uint    capacity    = 0;
+        };
+
+        void Compact();
+
+        std::vector<NodeId> data_;
+        std::vector<Slice>  slices_;
+
+        size_t unusedCount_ = 0;
+    };
+
+    /// Attach/detach requests issued by nodes while a level is updated in parallel.
+    /// They are applied once all nodes of the level are done.
+    struct TopologyRequest
+    {
+        bool    isAttach;
+        NodeId  nodeId;
+        NodeId  parentId;
+    };
+
+    /// Per-thread output of parallel level updates.
+    struct ParallelBuffer
+    {
+        std::vector<NodeId>             scheduledNodes;
+        std::vector<NodeId>             shiftedNodes;
+        std::vector<NodeId>             linkOutputNodes;
+        std::vector<NodeId>             markedNodes;
+        std::vector<NodeId>             prunedNodes;
+        std::vector<TopologyRequest>    topologyRequests;
+    };
+
+    /// Lock-free multi-producer, single-consumer list of inputs that other threads have pushed while
+    /// the graph was owned by another thread. Each input owns a copy of its value.
+    class InputBuffer
+    {
+    public:
+        struct Input
+        {
+            virtual ~Input() = default;
+            virtual void Apply() = 0;
+
+            NodeId  nodeId = invalid_node_id;
+            Input*  next = nullptr;
+        };
+
+        ~InputBuffer();
+
+        void Push(Input* input);
+
+        /// Removes all inputs and returns them in the order they were pushed.
+        Input* PopAll();
+
+        bool IsEmpty() const
+            { return head_.load() == nullptr; }
+
+    private:
+        std::atomic<Input*> head_{ nullptr };
+    };
+
+    template <typename F>
+    struct InputCallback : public InputBuffer::Input
+    {
+        explicit InputCallback(F&& f) :
+            func( std::move(f) )
+        { }
+
+        virtual void Apply() override
+            { func(); }
+
+        F func;
+    };
+
+    /// Priority queue of scheduled nodes, bucketed by level.
+    /// Push and fetching the next level are amortized O(1), since the min level cursor only
+    /// moves back if a node is pushed below it.
     class TopoQueue
     {
     public:
-        void Push(NodeId nodeId, int level)
-            { queueData_.emplace_back(nodeId, level); }
+        void Push(NodeId nodeId, int level);
 
         bool FetchNext();
 
         const std::vector<NodeId>& Next() const
             { return nextData_; }
 
+        int NextLevel() const
+            { return nextLevel_; }
+
         bool IsEmpty() const
-            { return queueData_.empty(); }
+            { return count_ == 0; }
 
     private:
-        using Entry = std::pair<NodeId /*nodeId*/, int /*level*/>;
+        std::vector<std::vector<NodeId>>    buckets_;
+        std::vector<NodeId>                 nextData_;
 
-        std::vector<Entry>  queueData_;
-        std::vector<NodeId> nextData_;
+        size_t  count_ = 0;
 
-        int minLevel_ = (std::numeric_limits<int>::max)();
+        int minLevel_   = (std::numeric_limits<int>::max)();
+        int nextLevel_  = 0;
     };
 
     void Propagate();
+    void PropagateSequential();
+    void PropagateLevelParallel();
+    void PropagatePulsecount();
+    void PropagateSubtree();
     void UpdateLinkNodes();
 
-    void ScheduleSuccessors(NodeData & node);
-    void RecalculateSuccessorLevels(NodeData & node);
+    void ScheduleSuccessors(NodeId nodeId);
+    void ScheduleSubtreeSuccessors(NodeId nodeId);
+    void MarkSubtree(NodeId rootId);
+    void RecalculateSuccessorLevels(NodeId nodeId);
+
+    UpdateResult UpdateNode(NodeId nodeId)
+    {
+#ifdef REACT_ENABLE_PROFILING
+        return UpdateNodeProfiled(nodeId);
+#else
+        auto& node = nodeData_[nodeId];
+
+        // Only a sample of the updates of automatic nodes is timed.
+        // Sequential propagation doesn't use weights, so it doesn't measure them either.
+        if (propagationMode_ == PropagationMode::sequential || node.weightHint != WeightHint::automatic
+            || (node.updateCount++ % cost_sample_interval) != 0)
+            return node.nodePtr->Update(currentTurnId_);
+
+        return UpdateNodeTimed(node);
+#endif
+    }
+
+    UpdateResult UpdateNodeTimed(NodeData& node);
+
+    void RecordUpdateCost(NodeData& node, float cost);
+
+#ifdef REACT_ENABLE_PROFILING
+    UpdateResult UpdateNodeProfiled(NodeId nodeId);
+#endif
+
+    bool ShouldPrune(NodeId nodeId) const
+        { return isPruningEnabled_ && nodeObservedCounts_[nodeId] == 0; }
+
+    bool IsOwnedByThisThread() const
+        { return ownerThread_.load() == std::this_thread::get_id(); }
+
+    bool TryAcquireOwnership();
+    void AcquireOwnership();
+    void ReleaseOwnership();
+
+    void ApplyBufferedInputs();
+    void DrainInputs();
+
+    void MarkStale(NodeId nodeId);
+    void IncObservedCount(NodeId nodeId);
+    void DecObservedCount(NodeId nodeId);
+    void RefreshStaleNodes(std::vector<NodeId>& nodes);
+
+    void ReserveNodeArrays(size_t size);
+
+    void ApplyShift(NodeId nodeId);
+    void MergeParallelBuffers();
 
 private:
     TransactionQueue    transactionQueue_{ *this };
 
     SlotMap<NodeData>   nodeData_;
 
+    // Hot per-node data, indexed by node id.
+    std::vector<int>        nodeLevels_;
+    AtomicArray<bool>       nodeQueued_;        // Nodes of the same level may schedule a shared successor concurrently.
+    AtomicArray<int>        nodePendingCounts_; // Predecessors that have to finish first (pulsecount, subtree).
+    AtomicArray<NodeMark>   nodeMarks_;
+    AdjacencyArena          nodeSuccessors_;
+    AdjacencyArena          nodePredecessors_;
+    std::vector<int>        nodeObservedCounts_; // Observed successors, +1 for nodes that are not prunable.
+    AtomicArray<bool>       nodeStale_;          // Skipped or depends on a skipped node.
+
     TopoQueue scheduledNodes_;
 
     std::vector<NodeId>         changedInputs_;
-    std::vector<IReactNode*>    changedNodes_;
+    std::vector<NodeId>         pulsecountRoots_;
+    std::vector<NodeId>         subtreeRoots_;
+    std::vector<NodeId>         subtreeNodes_;
+    std::vector<NodeId>         searchStack_;
+    std::vector<NodeId>         refreshNodes_;
+    std::vector<NodeId>         lightNodes_;
+
+#ifdef REACT_ENABLE_PROFILING
+    // Indexed by node id. Profiles of unregistered nodes have an invalid id.
+    std::vector<NodeProfile>    nodeProfiles_;
+
+    TraceSink traceSink_;
+#endif
 
     LinkOutputMap scheduledLinkOutputs_;
 
@@ -180,13 +703,58 @@ private:
 
     LinkCache linkCache_;
 
+    ThreadLocalStore<ParallelBuffer> parallelBuffers_;
+
+    PropagationMode propagationMode_ = PropagationMode::sequential;
+
+    TurnId currentTurnId_ = 0;
+
     int  transactionLevel_ = 0;
     bool allowLinkedTransactionMerging_ = false;
+    bool isInParallelPhase_ = false;
+    bool isPruningEnabled_ = false;
+    bool isConcurrentInputEnabled_ = false;
+
+    std::atomic<bool> isStateLinkCoalescingEnabled_{ false };
+
+    // With concurrent input, only the owning thread may apply inputs and propagate.
+    std::atomic<bool>               isOwned_{ false };
+    std::atomic<std::thread::id>    ownerThread_{ std::thread::id{ } };
+
+    InputBuffer inputBuffer_;
 };
 
 template <typename F>
 void ReactGraph::PushInput(NodeId nodeId, F&& inputCallback)
 {
+    if (isConcurrentInputEnabled_ && ! IsOwnedByThisThread())
+    {
+        if (TryAcquireOwnership())
+        {
+            // Uncontended. Inputs queued by other threads are older, so they go first.
+            ApplyBufferedInputs();
+
+            std::forward<F>(inputCallback)();
+            changedInputs_.push_back(nodeId);
+
+            Propagate();
+            ReleaseOwnership();
+        }
+        else
+        {
+            // Another thread is propagating. It picks up this input once it's done.
+            using CallbackType = InputCallback<typename std::decay<F>::type>;
+
+            auto* input = new CallbackType( typename std::decay<F>::type(std::forward<F>(inputCallback)) );
+            input->nodeId = nodeId;
+
+            inputBuffer_.Push(input);
+        }
+
+        DrainInputs();
+        return;
+    }
+
     auto& node = nodeData_[nodeId];
     auto* nodePtr = node.nodePtr;
 
@@ -202,18 +770,41 @@ void ReactGraph::PushInput(NodeId nodeId, F&& inputCallback)
 template <typename F>
 void ReactGraph::DoTransaction(F&& transactionCallback)
 {
-    // Transaction callback may add multiple inputs.
-    ++transactionLevel_;
-    std::forward<F>(transactionCallback)();
-    --transactionLevel_;
+    // Nested transactions already own the graph.
+    bool isOwner = isConcurrentInputEnabled_ && ! IsOwnedByThisThread();
 
-    Propagate();
+    if (isOwner)
+        AcquireOwnership();
+
+    {
+        REACT_TRACE_SCOPE(traceSink_, "transaction", currentTurnId_);
+
+        {
+            REACT_TRACE_SCOPE(traceSink_, "inputs", currentTurnId_);
+
+            if (isOwner)
+                ApplyBufferedInputs();
+
+            // Transaction callback may add multiple inputs.
+            ++transactionLevel_;
+            std::forward<F>(transactionCallback)();
+            --transactionLevel_;
+        }
+
+        Propagate();
+    }
+
+    if (isOwner)
+    {
+        ReleaseOwnership();
+        DrainInputs();
+    }
 }
 
 template <typename F>
-void ReactGraph::EnqueueTransaction(F&& func, SyncPoint::Dependency dep, TransactionFlags flags)
+TransactionTicket ReactGraph::EnqueueTransaction(F&& func, SyncPoint::Dependency dep, TransactionFlags flags)
 {
-    transactionQueue_.Push(std::forward<F>(func), std::move(dep), flags);
+    return transactionQueue_.Push(std::forward<F>(func), std::move(dep), flags, transactionQueue_.GetPolicy());
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
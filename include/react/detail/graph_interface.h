@@ -61,9 +61,6 @@ struct IReactNode
     virtual ~IReactNode() = default;
 
     virtual UpdateResult Update(TurnId turnId) noexcept = 0;
-    
-    virtual void Clear() noexcept
-        { }
 
     virtual void CollectOutput(LinkOutputMap& output)
         { }
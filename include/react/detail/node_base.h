@@ -13,6 +13,7 @@
 
 #include <iterator>
 #include <memory>
+#include <string>
 #include <utility>
 
 #include "react/common/utility.h"
@@ -48,21 +49,14 @@ public:
     NodeBase(NodeBase&&) = delete;
     NodeBase& operator=(NodeBase&&) = delete;
 
-    /*void SetWeightHint(WeightHint weight)
-    {
-        switch (weight)
-        {
-        case WeightHint::heavy :
-            this->ForceUpdateThresholdExceeded(true);
-            break;
-        case WeightHint::light :
-            this->ForceUpdateThresholdExceeded(false);
-            break;
-        case WeightHint::automatic :
-            this->ResetUpdateThreshold();
-            break;
-        }
-    }*/
+    void SetWeightHint(WeightHint weight)
+        { GetGraphPtr()->SetNodeWeightHint(nodeId_, weight); }
+
+    bool IsHeavy() const
+        { return GetGraphPtr()->IsNodeHeavy(nodeId_); }
+
+    void SetName(std::string name)
+        { GetGraphPtr()->SetNodeName(nodeId_, std::move(name)); }
 
     NodeId GetNodeId() const
         { return nodeId_; }
@@ -86,6 +80,10 @@ protected:
     void UnregisterMe()
         { GetGraphPtr()->UnregisterNode(nodeId_); }
 
+    /// Nodes without side effects can be skipped while nothing observes them.
+    void SetPrunable()
+        { GetGraphPtr()->SetNodePrunable(nodeId_); }
+
     void AttachToMe(NodeId otherNodeId)
         { GetGraphPtr()->AttachNode(nodeId_, otherNodeId); }
 
@@ -11,7 +11,9 @@
 
 #include "react/detail/defs.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <utility>
 #include <vector>
@@ -50,8 +52,23 @@ public:
     const S& Value() const
         { return value_; }
 
+    /// Lazy nodes compute their value when it's read by another node, see StateInternals.
+    bool IsLazy() const
+        { return isLazy_; }
+
+    /// Brings the value of a lazy node up-to-date.
+    virtual void Evaluate()
+        { }
+
+protected:
+    void SetLazy()
+        { isLazy_ = true; }
+
 private:
     S value_;
+
+    // Doesn't change after construction, so reading it is cheap for eager nodes.
+    bool isLazy_ = false;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -160,6 +177,7 @@ public:
         depHolder_( deps ... )
     {
         this->RegisterMe();
+        this->SetPrunable();
         REACT_EXPAND_PACK(this->AttachToMe(GetInternals(deps).GetNodeId()));
     }
 
@@ -191,6 +209,68 @@ private:
     std::tuple<State<TDeps> ...> depHolder_;
 };
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// StateLazyFuncNode
+///////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename S, typename F, typename ... TDeps>
+class StateLazyFuncNode : public StateNode<S>
+{
+public:
+    template <typename FIn>
+    StateLazyFuncNode(const Group& group, FIn&& func, const State<TDeps>& ... deps) :
+        StateLazyFuncNode::StateNode( group ),
+        func_( std::forward<FIn>(func) ),
+        depHolder_( deps ... )
+    {
+        this->RegisterMe();
+        this->SetPrunable();
+        REACT_EXPAND_PACK(this->AttachToMe(GetInternals(deps).GetNodeId()));
+
+        this->SetLazy();
+    }
+
+    ~StateLazyFuncNode()
+    {
+        apply([this] (const auto& ... deps)
+            { REACT_EXPAND_PACK(this->DetachFromMe(GetInternals(deps).GetNodePtr()->GetNodeId())); }, depHolder_);
+        this->UnregisterMe();
+    }
+
+    virtual UpdateResult Update(TurnId turnId) noexcept override
+    {
+        // The new value isn't known until it's computed, so successors are always notified.
+        // Eager successors will compute it when they read it.
+        isDirty_.store(true, std::memory_order_release);
+        return UpdateResult::changed;
+    }
+
+    virtual void Evaluate() override
+    {
+        if (! isDirty_.load(std::memory_order_acquire))
+            return;
+
+        // Successors of the same level might read the value concurrently.
+        std::lock_guard<std::mutex> scopedLock(evalMutex_);
+
+        if (! isDirty_.load(std::memory_order_relaxed))
+            return;
+
+        this->Value() = apply([this] (const auto& ... deps)
+            { return this->func_(GetInternals(deps).Value() ...); }, depHolder_);
+
+        isDirty_.store(false, std::memory_order_release);
+    }
+
+private:
+    F func_;
+    std::tuple<State<TDeps> ...> depHolder_;
+
+    // Nothing has been computed yet.
+    std::atomic<bool> isDirty_{ true };
+
+    std::mutex evalMutex_;
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 /// StateSlotNode
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -300,6 +380,31 @@ public:
         { this->Value() = std::move(newValue); }
 
 private:
+    // Called by the source group. Returns true if no pending update will pick up the value.
+    bool SetPendingValue(const S& newValue)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+
+        if (pendingValue_)
+            *pendingValue_ = newValue;
+        else
+            pendingValue_ = std::make_unique<S>(newValue);
+
+        bool wasScheduled = isUpdateScheduled_;
+        isUpdateScheduled_ = true;
+
+        return ! wasScheduled;
+    }
+
+    // Called by the target group.
+    std::unique_ptr<S> TakePendingValue()
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+
+        isUpdateScheduled_ = false;
+        return std::move(pendingValue_);
+    }
+
     struct VirtualOutputNode : public IReactNode
     {
         virtual UpdateResult Update(TurnId turnId) noexcept override
@@ -310,19 +415,59 @@ private:
             if (auto p = parent.lock())
             {
                 auto* rawPtr = p->GetGraphPtr().get();
-                output[rawPtr].push_back([storedParent = std::move(p), storedValue = GetInternals(p->dep_).Value()] () mutable -> void
-                    {
-                        NodeId nodeId = storedParent->GetNodeId();
-                        auto& graphPtr = storedParent->GetGraphPtr();
-
-                        graphPtr->PushInput(nodeId, [&storedParent, &storedValue]
-                            {
-                                storedParent->SetValue(std::move(storedValue));
-                            });
-                    });
+
+                if (rawPtr->IsStateLinkCoalescingEnabled())
+                    CollectCoalescedOutput(output, std::move(p));
+                else
+                    CollectValueOutput(output, std::move(p));
             }
         }
 
+        void CollectValueOutput(LinkOutputMap& output, std::shared_ptr<StateLinkNode>&& p)
+        {
+            auto* rawPtr = p->GetGraphPtr().get();
+            const S& value = GetInternals(p->dep_).Value();
+
+            output[rawPtr].push_back([storedParent = std::move(p), storedValue = value] () mutable -> void
+                {
+                    NodeId nodeId = storedParent->GetNodeId();
+                    auto& graphPtr = storedParent->GetGraphPtr();
+
+                    graphPtr->PushInput(nodeId, [&storedParent, &storedValue]
+                        {
+                            storedParent->SetValue(std::move(storedValue));
+                        });
+                });
+        }
+
+        void CollectCoalescedOutput(LinkOutputMap& output, std::shared_ptr<StateLinkNode>&& p)
+        {
+            auto* rawPtr = p->GetGraphPtr().get();
+            bool needsUpdate = p->SetPendingValue(GetInternals(p->dep_).Value());
+
+            // Transactions that release linked sync points still need their own update, so the
+            // sync point isn't released before the value has been applied. The update is empty if
+            // an earlier one has already taken the value.
+            if (! needsUpdate && ! GetInternals(p->srcGroup_).GetGraphPtr()->HasLinkDependencies())
+                return;
+
+            output[rawPtr].push_back([storedParent = std::move(p)]
+                {
+                    std::unique_ptr<S> value = storedParent->TakePendingValue();
+
+                    if (! value)
+                        return;
+
+                    NodeId nodeId = storedParent->GetNodeId();
+                    auto& graphPtr = storedParent->GetGraphPtr();
+
+                    graphPtr->PushInput(nodeId, [&storedParent, &value]
+                        {
+                            storedParent->SetValue(std::move(*value));
+                        });
+                });
+        }
+
         std::weak_ptr<StateLinkNode> parent;
     };
 
@@ -331,6 +476,10 @@ private:
     NodeId      outputNodeId_;
 
     VirtualOutputNode linkOutput_;
+
+    std::mutex          pendingMutex_;
+    std::unique_ptr<S>  pendingValue_;
+    bool                isUpdateScheduled_ = false;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -361,11 +510,22 @@ public:
     NodeId GetNodeId() const
         { return nodePtr_->GetNodeId(); }
 
+    /// Reads the value of the node, computing it first if the node is lazy and out of date.
     S& Value()
-        { return nodePtr_->Value(); }
+    {
+        if (nodePtr_->IsLazy())
+            nodePtr_->Evaluate();
+
+        return nodePtr_->Value();
+    }
 
     const S& Value() const
-        { return nodePtr_->Value(); }
+    {
+        if (nodePtr_->IsLazy())
+            nodePtr_->Evaluate();
+
+        return nodePtr_->Value();
+    }
 
 private:
     std::shared_ptr<StateNode<S>> nodePtr_;
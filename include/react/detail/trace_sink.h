@@ -0,0 +1,134 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef REACT_DETAIL_TRACE_SINK_H_INCLUDED
+#define REACT_DETAIL_TRACE_SINK_H_INCLUDED
+
+#pragma once
+
+#include "react/detail/defs.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "react/common/threadlocal.h"
+#include "react/detail/graph_interface.h"
+
+/***************************************/ REACT_IMPL_BEGIN /**************************************/
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// TraceSink
+/// Records timed events and writes them as Chrome trace-event JSON.
+/// Each thread appends to its own buffer, so recording never blocks other threads.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class TraceSink
+{
+public:
+    using ClockType = std::chrono::steady_clock;
+    using TimePoint = ClockType::time_point;
+
+    /// Maps node ids to user-supplied names. May return an empty string.
+    using NameLookup = std::function<std::string(NodeId)>;
+
+    /// Discards previously recorded events and starts recording.
+    void Start();
+
+    /// Stops recording and writes everything that was recorded since Start().
+    /// Must not be called while events are being recorded.
+    void Stop(std::ostream& out, const NameLookup& lookup);
+
+    bool IsActive() const
+        { return isActive_.load(std::memory_order_relaxed); }
+
+    /// Complete event with duration. Node id may be invalid if the event doesn't belong to a node.
+    void Complete(const char* name, NodeId nodeId, size_t value, TimePoint start, TimePoint end);
+
+    void Counter(const char* name, size_t value);
+
+private:
+    struct TraceEvent
+    {
+        const char* name;
+        char        phase;
+        NodeId      nodeId;
+        size_t      value;
+        int64_t     timestamp;
+        int64_t     duration;
+    };
+
+    struct ThreadBuffer
+    {
+        uint                    threadIndex = 0;
+        std::vector<TraceEvent> events;
+    };
+
+    ThreadBuffer& LocalBuffer();
+
+    int64_t ToNanoseconds(TimePoint t) const
+        { return std::chrono::duration_cast<std::chrono::nanoseconds>(t - startTime_).count(); }
+
+    std::atomic<bool> isActive_{ false };
+    std::atomic<uint> threadCount_{ 0 };
+
+    TimePoint startTime_;
+
+    ThreadLocalStore<ThreadBuffer> threadBuffers_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// TraceScope
+/// Records a complete event spanning the lifetime of this object, if the sink is active.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class TraceScope
+{
+public:
+    TraceScope(TraceSink& sink, const char* name, NodeId nodeId, size_t value) :
+        sink_( sink ),
+        name_( name ),
+        nodeId_( nodeId ),
+        value_( value ),
+        isActive_( sink.IsActive() )
+    {
+        if (isActive_)
+            start_ = TraceSink::ClockType::now();
+    }
+
+    ~TraceScope()
+    {
+        if (isActive_)
+            sink_.Complete(name_, nodeId_, value_, start_, TraceSink::ClockType::now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceSink&              sink_;
+    const char*             name_;
+    NodeId                  nodeId_;
+    size_t                  value_;
+    bool                    isActive_;
+    TraceSink::TimePoint    start_;
+};
+
+/****************************************/ REACT_IMPL_END /***************************************/
+
+// Tracing is only compiled in with profiling enabled.
+#ifdef REACT_ENABLE_PROFILING
+    #define REACT_TRACE_SCOPE(sink, name, value) \
+        REACT_IMPL::TraceScope reactTraceScope( sink, name, REACT_IMPL::invalid_node_id, value )
+    #define REACT_TRACE_COUNTER(sink, name, value) \
+        do { if ((sink).IsActive()) (sink).Counter(name, value); } while (false)
+#else
+    #define REACT_TRACE_SCOPE(sink, name, value)
+    #define REACT_TRACE_COUNTER(sink, name, value)
+#endif
+
+#endif // REACT_DETAIL_TRACE_SINK_H_INCLUDED
@@ -65,6 +65,22 @@ public:
     auto GetGroup() -> Group&
         { return GetNodePtr()->GetGroup(); }
 
+    /// Heavy nodes are updated on worker threads, light nodes inline by the propagating thread.
+    /// By default, this is decided by measuring the update cost.
+    /// Must not be called while a transaction of this group is in progress.
+    void SetWeightHint(WeightHint weight)
+        { GetNodePtr()->SetWeightHint(weight); }
+
+    /// Current weight of this node. Automatic weights are only measured by the propagation
+    /// modes that use them, so in sequential mode, only heavy hints are reported.
+    /// Must not be called while a transaction of this group is in progress.
+    bool IsHeavy() const
+        { return GetNodePtr()->IsHeavy(); }
+
+    /// Identifies this node in profiles.
+    void SetName(std::string name)
+        { GetNodePtr()->SetName(std::move(name)); }
+
     friend bool operator==(const Event<E>& a, const Event<E>& b)
         { return a.GetNodePtr() == b.GetNodePtr(); }
 
@@ -165,7 +181,7 @@ private:
         NodeId nodeId = castedPtr->GetNodeId();
         auto& graphPtr = GetInternals(this->GetGroup()).GetGraphPtr();
 
-        graphPtr->PushInput(nodeId, [castedPtr, &value] { castedPtr->EmitValue(std::forward<T>(value)); });
+        graphPtr->PushInput(nodeId, [castedPtr, storedValue = std::forward<T>(value)] () mutable { castedPtr->EmitValue(std::move(storedValue)); });
     }
 };
 
@@ -219,7 +235,7 @@ private:
         NodeId nodeId = castedPtr->GetInputNodeId();
         auto& graphPtr = GetInternals(this->GetGroup()).GetGraphPtr();
 
-        graphPtr->PushInput(nodeId, [this, castedPtr, &input] { castedPtr->AddSlotInput(SameGroupOrLink(GetGroup(), input)); });
+        graphPtr->PushInput(nodeId, [castedPtr, input] { castedPtr->AddSlotInput(SameGroupOrLink(castedPtr->GetGroup(), input)); });
     }
 
     void RemoveSlotInput(const Event<E>& input)
@@ -232,7 +248,7 @@ private:
         NodeId nodeId = castedPtr->GetInputNodeId();
         auto& graphPtr = GetInternals(this->GetGroup()).GetGraphPtr();
 
-        graphPtr->PushInput(nodeId, [this, castedPtr, &input] { castedPtr->RemoveSlotInput(SameGroupOrLink(GetGroup(), input)); });
+        graphPtr->PushInput(nodeId, [castedPtr, input] { castedPtr->RemoveSlotInput(SameGroupOrLink(castedPtr->GetGroup(), input)); });
     }
 
     void RemoveAllSlotInputs()
@@ -0,0 +1,153 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef REACT_EXECUTOR_H_INCLUDED
+#define REACT_EXECUTOR_H_INCLUDED
+
+#pragma once
+
+#include "react/detail/defs.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*****************************************/ REACT_BEGIN /*****************************************/
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// Executor
+/// Runs the worker that processes enqueued transactions of a group.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class Executor
+{
+public:
+    virtual ~Executor() = default;
+
+    /// Runs func once, on any thread. The worker processes transactions until its queue is empty,
+    /// so a new one is only posted after the previous one has returned.
+    virtual void Post(std::function<void()> func) = 0;
+
+    /// If non-zero, the worker returns once this much time has passed and posts itself again,
+    /// so other work can run in between.
+    virtual std::chrono::microseconds GetTimeSlice() const
+        { return std::chrono::microseconds::zero(); }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// TbbExecutor
+/// Enqueues work into the current TBB task arena. This is the default.
+/// Not available if REACT_DISABLE_TBB is defined.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef REACT_DISABLE_TBB
+
+class TbbExecutor : public Executor
+{
+public:
+    void Post(std::function<void()> func) override;
+};
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// ThreadPoolExecutor
+/// Fixed number of std::threads. Work that was posted before destruction is still finished.
+/// If the executor is destroyed on one of its own threads, that thread is detached instead.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class ThreadPoolExecutor : public Executor
+{
+public:
+    explicit ThreadPoolExecutor(size_t threadCount = 1);
+
+    ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+    ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+
+    ~ThreadPoolExecutor() override;
+
+    void Post(std::function<void()> func) override;
+
+private:
+    struct State
+    {
+        std::mutex                          mutex;
+        std::condition_variable             condition;
+        std::deque<std::function<void()>>   work;
+        bool                                isStopped = false;
+    };
+
+    static void Run(const std::shared_ptr<State>& state);
+
+    // Shared with the threads, so a detached thread can outlive the executor.
+    std::shared_ptr<State>              state_;
+
+    std::vector<std::thread>            threads_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// InlineExecutor
+/// Runs work immediately on the posting thread, so EnqueueTransaction only returns once the
+/// queue is empty.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class InlineExecutor : public Executor
+{
+public:
+    void Post(std::function<void()> func) override
+        { func(); }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// GroupScheduler
+/// Thread pool that is shared by many groups. Each group gets its own executor, which sticks to
+/// the thread that ran it last. Every thread has its own queue that it serves in FIFO order, and
+/// idle threads steal the oldest work from the others.
+/// Group workers return after each time slice, so a busy group can't starve the others.
+/// Must be created with std::make_shared. Executors keep their scheduler alive, so it can be
+/// destroyed on one of its own threads. That thread is detached and finishes the pending work.
+///////////////////////////////////////////////////////////////////////////////////////////////////
+class GroupScheduler : public std::enable_shared_from_this<GroupScheduler>
+{
+public:
+    explicit GroupScheduler(size_t threadCount = std::thread::hardware_concurrency(),
+        std::chrono::microseconds timeSlice = std::chrono::milliseconds(1));
+
+    GroupScheduler(const GroupScheduler&) = delete;
+    GroupScheduler& operator=(const GroupScheduler&) = delete;
+
+    ~GroupScheduler();
+
+    /// Returns a new executor for a single group, i.e. group.SetExecutor(scheduler->CreateExecutor()).
+    std::shared_ptr<Executor> CreateExecutor();
+
+    size_t GetThreadCount() const
+        { return threads_.size(); }
+
+    std::chrono::microseconds GetTimeSlice() const
+        { return timeSlice_; }
+
+private:
+    class GroupExecutor;
+
+    struct State;
+
+    static void Run(const std::shared_ptr<State>& state, size_t index);
+
+    std::chrono::microseconds       timeSlice_;
+
+    // Shared with the threads, so a detached thread can outlive the scheduler.
+    std::shared_ptr<State>          state_;
+
+    std::atomic<size_t>             nextHome_{ 0 };
+
+    std::vector<std::thread>        threads_;
+};
+
+/******************************************/ REACT_END /******************************************/
+
+#endif // REACT_EXECUTOR_H_INCLUDED
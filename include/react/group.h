@@ -12,10 +12,13 @@
 #include "react/detail/defs.h"
 
 #include <memory>
+#include <ostream>
 #include <utility>
+#include <vector>
 
 #include "react/API.h"
 #include "react/common/syncpoint.h"
+#include "react/executor.h"
 
 #include "react/detail/graph_interface.h"
 #include "react/detail/graph_impl.h"
@@ -36,17 +39,109 @@ public:
     Group(Group&&) = default;
     Group& operator=(Group&&) = default;
 
+    /// Selects how changes are propagated through the graph of this group.
+    /// Must not be called while a transaction of this group is in progress.
+    void SetPropagationMode(PropagationMode mode)
+        { GetGraphPtr()->SetPropagationMode(mode); }
+
+    /// If enabled, nodes that are not reachable by any observer are skipped during propagation.
+    /// They are brought up-to-date once they become observed again.
+    /// Must not be called while a transaction of this group is in progress.
+    void SetPruningEnabled(bool enabled)
+        { GetGraphPtr()->SetPruningEnabled(enabled); }
+
+    /// Update statistics of all nodes in this group.
+    /// Empty unless the library was built with REACT_ENABLE_PROFILING.
+    /// Must not be called while a transaction of this group is in progress.
+    std::vector<NodeProfile> GetProfile() const
+        { return GetGraphPtr()->GetProfile(); }
+
+    void ResetProfile()
+        { GetGraphPtr()->ResetProfile(); }
+
+    /// Records transactions, turns, levels and node updates of this group until StopTrace() is
+    /// called, which writes them as Chrome trace-event JSON.
+    /// Does nothing unless the library was built with REACT_ENABLE_PROFILING.
+    /// Must not be called while a transaction of this group is in progress.
+    void StartTrace()
+        { GetGraphPtr()->StartTrace(); }
+
+    void StopTrace(std::ostream& out)
+        { GetGraphPtr()->StopTrace(out); }
+
+    /// Latency, execution time, merge batch size and queue depth histograms of enqueued transactions.
+    /// Can be called at any time.
+    TransactionStats GetTransactionStats() const
+        { return GetGraphPtr()->GetTransactionQueue().GetStats(); }
+
+    void ResetTransactionStats()
+        { GetGraphPtr()->GetTransactionQueue().ResetStats(); }
+
+    /// Blocks until all transactions that were enqueued before the call are done.
+    /// Must not be called from inside a transaction.
+    void WaitIdle() const
+        { GetGraphPtr()->GetTransactionQueue().WaitForPending(); }
+
+    /// If enabled, inputs can be set or emitted from multiple threads without EnqueueTransaction.
+    /// An input that arrives while another thread is propagating is queued, and that thread
+    /// propagates all queued inputs as a batch once it's done.
+    /// Nodes must not be created or destroyed concurrently to inputs.
+    /// Must not be called while a transaction of this group is in progress.
+    void SetConcurrentInputEnabled(bool enabled)
+        { GetGraphPtr()->SetConcurrentInputEnabled(enabled); }
+
+    /// If enabled, state links into this group only apply the latest value of their source.
+    /// A link update that's still pending when the source changes again is replaced in place,
+    /// instead of queueing another transaction that carries the new value.
+    void SetStateLinkCoalescingEnabled(bool enabled)
+        { GetGraphPtr()->SetStateLinkCoalescingEnabled(enabled); }
+
     template <typename F>
     void DoTransaction(F&& func)
         { GetGraphPtr()->DoTransaction(std::forward<F>(func)); }
 
+    /// Maximum number of pending transactions per priority. Rounded up to the next power of two.
+    /// Must not be called while transactions of this group are pending.
+    void SetTransactionQueueCapacity(size_t capacity)
+        { GetGraphPtr()->GetTransactionQueue().SetCapacity(capacity); }
+
+    /// What EnqueueTransaction does if the queue is full. The default is to block.
+    /// Must not be called concurrently to EnqueueTransaction.
+    void SetTransactionQueuePolicy(QueueFullPolicy policy)
+        { GetGraphPtr()->GetTransactionQueue().SetPolicy(policy); }
+
+    /// Limits how many mergeable transactions are executed in a single turn, and how long to wait
+    /// for more. The graph stays locked while waiting, so concurrent input has to wait as well.
+    /// Must not be called while transactions of this group are pending.
+    void SetCoalescingPolicy(const CoalescingPolicy& policy)
+        { GetGraphPtr()->GetTransactionQueue().SetCoalescingPolicy(policy); }
+
+    /// Executor that runs the worker of the transaction queue. Defaults to TbbExecutor, or to
+    /// ThreadPoolExecutor if REACT_DISABLE_TBB is defined.
+    /// Must not be called while transactions of this group are pending.
+    void SetExecutor(std::shared_ptr<Executor> executor)
+        { GetGraphPtr()->GetTransactionQueue().SetExecutor(std::move(executor)); }
+
+    /// If enabled, EnqueueTransaction runs the transaction on the calling thread if the queue is idle.
+    /// This saves the hand-off to the executor. Only the first turn is run by the caller, anything
+    /// that was enqueued in the meantime is posted to the executor afterwards.
+    /// If the queue is busy, or the transaction has the non_blocking flag, it's queued as usual.
+    /// Must not be called while transactions of this group are pending.
+    void SetCallerRunsEnabled(bool enabled)
+        { GetGraphPtr()->GetTransactionQueue().SetCallerRunsEnabled(enabled); }
+
+    /// Transactions with high_priority or low_priority flags are queued in separate lanes.
+    /// Higher lanes are always executed first, and transactions are only merged within a lane.
+    /// The returned ticket can be used to wait for the transaction. It's invalid if the transaction
+    /// was rejected because the queue is full.
+    /// Blocking from inside a transaction of this group would never finish, so it fails as well.
     template <typename F>
-    void EnqueueTransaction(F&& func, TransactionFlags flags = TransactionFlags::none)
-        { GetGraphPtr()->EnqueueTransaction(std::forward<F>(func), SyncPoint::Dependency{ }, flags); }
+    TransactionTicket EnqueueTransaction(F&& func, TransactionFlags flags = TransactionFlags::none)
+        { return GetGraphPtr()->EnqueueTransaction(std::forward<F>(func), SyncPoint::Dependency{ }, flags); }
 
     template <typename F>
-    void EnqueueTransaction(F&& func, const SyncPoint& syncPoint, TransactionFlags flags = TransactionFlags::none)
-        { GetGraphPtr()->EnqueueTransaction(std::forward<F>(func), SyncPoint::Dependency{ syncPoint }, flags); }
+    TransactionTicket EnqueueTransaction(F&& func, const SyncPoint& syncPoint, TransactionFlags flags = TransactionFlags::none)
+        { return GetGraphPtr()->EnqueueTransaction(std::forward<F>(func), SyncPoint::Dependency{ syncPoint }, flags); }
 
     friend bool operator==(const Group& a, const Group& b)
         { return a.GetGraphPtr() == b.GetGraphPtr(); }
@@ -39,6 +39,17 @@ public:
     static State Create(F&& func, const State<T1>& dep1, const State<Ts>& ... deps)
         { return CreateFuncNode(dep1.GetGroup(), std::forward<F>(func), dep1, deps ...); }
 
+    // Construct lazily evaluated node with explicit group
+    // Its value is computed on first access after a change, so S has to be default constructible
+    template <typename F, typename T1, typename ... Ts>
+    static State CreateLazy(const Group& group, F&& func, const State<T1>& dep1, const State<Ts>& ... deps)
+        { return CreateLazyFuncNode(group, std::forward<F>(func), dep1, deps ...); }
+
+    // Construct lazily evaluated node with implicit group
+    template <typename F, typename T1, typename ... Ts>
+    static State CreateLazy(F&& func, const State<T1>& dep1, const State<Ts>& ... deps)
+        { return CreateLazyFuncNode(dep1.GetGroup(), std::forward<F>(func), dep1, deps ...); }
+
     // Construct with constant value
     template <typename T>
     static State Create(const Group& group, T&& init)
@@ -58,6 +69,22 @@ public:
     auto GetGroup() -> Group&
         { return this->GetNodePtr()->GetGroup(); }
 
+    /// Heavy nodes are updated on worker threads, light nodes inline by the propagating thread.
+    /// By default, this is decided by measuring the update cost.
+    /// Must not be called while a transaction of this group is in progress.
+    void SetWeightHint(WeightHint weight)
+        { this->GetNodePtr()->SetWeightHint(weight); }
+
+    /// Current weight of this node. Automatic weights are only measured by the propagation
+    /// modes that use them, so in sequential mode, only heavy hints are reported.
+    /// Must not be called while a transaction of this group is in progress.
+    bool IsHeavy() const
+        { return this->GetNodePtr()->IsHeavy(); }
+
+    /// Identifies this node in profiles.
+    void SetName(std::string name)
+        { this->GetNodePtr()->SetName(std::move(name)); }
+
     friend bool operator==(const State<S>& a, const State<S>& b)
         { return a.GetNodePtr() == b.GetNodePtr(); }
 
@@ -86,6 +113,16 @@ private:
             group, std::forward<F>(func), SameGroupOrLink(group, dep1), SameGroupOrLink(group, deps) ...);
     }
 
+    template <typename F, typename T1, typename ... Ts>
+    static auto CreateLazyFuncNode(const Group& group, F&& func, const State<T1>& dep1, const State<Ts>& ... deps) -> decltype(auto)
+    {
+        using REACT_IMPL::StateLazyFuncNode;
+        using REACT_IMPL::SameGroupOrLink;
+
+        return std::make_shared<StateLazyFuncNode<S, typename std::decay<F>::type, T1, Ts ...>>(
+            group, std::forward<F>(func), SameGroupOrLink(group, dep1), SameGroupOrLink(group, deps) ...);
+    }
+
     template <typename RET, typename NODE, typename ... ARGS>
     friend RET impl::CreateWrappedNode(ARGS&& ... args);
 };
@@ -121,8 +158,8 @@ public:
         { SetValue(std::move(newValue)); }
 
     template <typename F>
-    void Modify(const F& func)
-        { ModifyValue(func); }
+    void Modify(F&& func)
+        { ModifyValue(std::forward<F>(func)); }
 
     friend bool operator==(const StateVar<S>& a, StateVar<S>& b)
         { return a.GetNodePtr() == b.GetNodePtr(); }
@@ -163,11 +200,11 @@ private:
         NodeId nodeId = castedPtr->GetNodeId();
         auto& graphPtr = GetInternals(this->GetGroup()).GetGraphPtr();
 
-        graphPtr->PushInput(nodeId, [castedPtr, &newValue] { castedPtr->SetValue(std::forward<T>(newValue)); });
+        graphPtr->PushInput(nodeId, [castedPtr, value = std::forward<T>(newValue)] () mutable { castedPtr->SetValue(std::move(value)); });
     }
 
     template <typename F>
-    void ModifyValue(const F& func)
+    void ModifyValue(F&& func)
     {
         using REACT_IMPL::NodeId;
         using VarNodeType = REACT_IMPL::StateVarNode<S>;
@@ -177,7 +214,8 @@ private:
         NodeId nodeId = castedPtr->GetNodeId();
         auto& graphPtr = GetInternals(this->GetGroup()).GetGraphPtr();
 
-        graphPtr->PushInput(nodeId, [castedPtr, &func] { castedPtr->ModifyValue(func); });
+        // Moved in, so move-only and mutable callables work. It's only copied if it's an lvalue.
+        graphPtr->PushInput(nodeId, [castedPtr, f = std::forward<F>(func)] () mutable { castedPtr->ModifyValue(f); });
     }
 };
 
@@ -232,7 +270,7 @@ private:
         NodeId nodeId = castedPtr->GetInputNodeId();
         auto& graphPtr = GetInternals(this->GetGroup()).GetGraphPtr();
 
-        graphPtr->PushInput(nodeId, [this, castedPtr, &newInput] { castedPtr->SetInput(SameGroupOrLink(GetGroup(), newInput)); });
+        graphPtr->PushInput(nodeId, [castedPtr, newInput] { castedPtr->SetInput(SameGroupOrLink(castedPtr->GetGroup(), newInput)); });
     }
 };
 
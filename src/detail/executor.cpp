@@ -0,0 +1,263 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "react/detail/defs.h"
+
+#include <utility>
+
+#ifndef REACT_DISABLE_TBB
+#include <tbb/task_arena.h>
+#endif
+
+#include "react/executor.h"
+
+/*****************************************/ REACT_BEGIN /*****************************************/
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// TbbExecutor
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef REACT_DISABLE_TBB
+
+void TbbExecutor::Post(std::function<void()> func)
+{
+    tbb::this_task_arena::enqueue(std::move(func));
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// ThreadPoolExecutor
+///////////////////////////////////////////////////////////////////////////////////////////////////
+ThreadPoolExecutor::ThreadPoolExecutor(size_t threadCount) :
+    state_( std::make_shared<State>() )
+{
+    threads_.reserve(threadCount);
+
+    for (size_t i = 0; i < threadCount; ++i)
+        threads_.emplace_back(&ThreadPoolExecutor::Run, state_);
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->isStopped = true;
+    }
+
+    state_->condition.notify_all();
+
+    // A thread can't join itself. It still holds the state and exits when the work is done.
+    for (auto& t : threads_)
+    {
+        if (t.get_id() == std::this_thread::get_id())
+            t.detach();
+        else
+            t.join();
+    }
+}
+
+void ThreadPoolExecutor::Post(std::function<void()> func)
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->work.push_back(std::move(func));
+    }
+
+    state_->condition.notify_one();
+}
+
+void ThreadPoolExecutor::Run(const std::shared_ptr<State>& state)
+{
+    for (;;)
+    {
+        std::function<void()> func;
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait(lock, [&] { return state->isStopped || ! state->work.empty(); });
+
+            // Pending work is finished before stopping.
+            if (state->work.empty())
+                return;
+
+            func = std::move(state->work.front());
+            state->work.pop_front();
+        }
+
+        func();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/// GroupScheduler
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct GroupScheduler::State
+{
+    struct Task
+    {
+        Task() = default;
+
+        Task(std::function<void()>&& f, GroupExecutor* o) :
+            func( std::move(f) ),
+            owner( o )
+        { }
+
+        std::function<void()>   func;
+        GroupExecutor*          owner = nullptr;
+    };
+
+    // new[] doesn't honor over-alignment before C++17, so the queues are padded instead.
+    // Trailing padding keeps the hot members of neighbouring queues on different cache lines.
+    struct WorkerQueue
+    {
+        std::mutex          mutex;
+        std::deque<Task>    tasks;
+        char                padding[64];
+    };
+
+    explicit State(size_t count) :
+        queues( new WorkerQueue[count] ),
+        queueCount( count )
+    { }
+
+    void Push(size_t index, Task&& task);
+
+    bool TryPop(size_t index, Task& task);
+
+    bool TrySteal(size_t index, Task& task);
+
+    std::unique_ptr<WorkerQueue[]>  queues;
+    size_t                          queueCount;
+
+    std::atomic<size_t>             pendingCount{ 0 };
+
+    std::mutex                      idleMutex;
+    std::condition_variable         idleCondition;
+    bool                            isStopped = false;
+};
+
+class GroupScheduler::GroupExecutor : public Executor
+{
+public:
+    GroupExecutor(std::shared_ptr<GroupScheduler>&& scheduler, size_t home) :
+        scheduler_( std::move(scheduler) ),
+        home_( home )
+    { }
+
+    void Post(std::function<void()> func) override
+        { scheduler_->state_->Push(home_.load(std::memory_order_relaxed), State::Task{ std::move(func), this }); }
+
+    std::chrono::microseconds GetTimeSlice() const override
+        { return scheduler_->timeSlice_; }
+
+    void SetHome(size_t index)
+        { home_.store(index, std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<GroupScheduler> scheduler_;
+    std::atomic<size_t>             home_;
+};
+
+GroupScheduler::GroupScheduler(size_t threadCount, std::chrono::microseconds timeSlice) :
+    timeSlice_( timeSlice ),
+    state_( std::make_shared<State>(threadCount != 0 ? threadCount : 1) )
+{
+    threads_.reserve(state_->queueCount);
+
+    for (size_t i = 0; i < state_->queueCount; ++i)
+        threads_.emplace_back(&GroupScheduler::Run, state_, i);
+}
+
+GroupScheduler::~GroupScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->idleMutex);
+        state_->isStopped = true;
+    }
+
+    state_->idleCondition.notify_all();
+
+    // The last executor may be released on one of our threads, which can't join itself.
+    // It still holds the state and exits when the pending work is done.
+    for (auto& t : threads_)
+    {
+        if (t.get_id() == std::this_thread::get_id())
+            t.detach();
+        else
+            t.join();
+    }
+}
+
+std::shared_ptr<Executor> GroupScheduler::CreateExecutor()
+{
+    // Spread new groups evenly. Afterwards they follow the thread that runs them.
+    size_t home = nextHome_.fetch_add(1, std::memory_order_relaxed) % state_->queueCount;
+    return std::make_shared<GroupExecutor>(shared_from_this(), home);
+}
+
+void GroupScheduler::State::Push(size_t index, Task&& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(queues[index].mutex);
+        queues[index].tasks.push_back(std::move(task));
+        pendingCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Wakes an idle thread. If it's not the home thread, it steals the task.
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+    }
+
+    idleCondition.notify_one();
+}
+
+bool GroupScheduler::State::TryPop(size_t index, Task& task)
+{
+    std::lock_guard<std::mutex> lock(queues[index].mutex);
+    auto& tasks = queues[index].tasks;
+
+    if (tasks.empty())
+        return false;
+
+    task = std::move(tasks.front());
+    tasks.pop_front();
+    pendingCount.fetch_sub(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+bool GroupScheduler::State::TrySteal(size_t index, Task& task)
+{
+    for (size_t i = 1; i < queueCount; ++i)
+        if (TryPop((index + i) % queueCount, task))
+            return true;
+
+    return false;
+}
+
+void GroupScheduler::Run(const std::shared_ptr<State>& state, size_t index)
+{
+    for (;;)
+    {
+        State::Task task;
+
+        if (state->TryPop(index, task) || state->TrySteal(index, task))
+        {
+            // Set before running, because the group may be gone as soon as its worker returns.
+            task.owner->SetHome(index);
+            task.func();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(state->idleMutex);
+        state->idleCondition.wait(lock, [&] { return state->isStopped || state->pendingCount.load(std::memory_order_relaxed) != 0; });
+
+        // Pending work is finished before stopping.
+        if (state->isStopped && state->pendingCount.load(std::memory_order_relaxed) == 0)
+            return;
+    }
+}
+
+/******************************************/ REACT_END /******************************************/
@@ -7,14 +7,15 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <limits>
 #include <type_traits>
 #include <utility>
 #include <vector>
 #include <map>
 #include <mutex>
+#include <thread>
 
-#include <tbb/concurrent_queue.h>
-#include <tbb/task.h>
 
 #include "react/detail/graph_interface.h"
 #include "react/detail/graph_impl.h"
@@ -24,31 +25,178 @@
 
 NodeId ReactGraph::RegisterNode(IReactNode* nodePtr, NodeCategory category)
 {
-    return nodeData_.Insert(NodeData{ nodePtr, category });
+    NodeId nodeId = nodeData_.Insert(NodeData{ nodePtr, category });
+
+    if (nodeId >= nodeLevels_.size())
+        ReserveNodeArrays(nodeId + 1);
+
+    // Slot might be re-used, so reset everything.
+    nodeLevels_[nodeId] = 0;
+    nodeQueued_[nodeId].store(false, std::memory_order_relaxed);
+    nodePendingCounts_[nodeId].store(0, std::memory_order_relaxed);
+    nodeMarks_[nodeId].store(NodeMark::unmarked, std::memory_order_relaxed);
+    nodeSuccessors_.Register(nodeId);
+    nodePredecessors_.Register(nodeId);
+
+    // Nodes are pinned as observed, unless they are made prunable.
+    nodeObservedCounts_[nodeId] = 1;
+    nodeStale_[nodeId].store(false, std::memory_order_relaxed);
+
+#ifdef REACT_ENABLE_PROFILING
+    nodeProfiles_[nodeId] = NodeProfile{ };
+    nodeProfiles_[nodeId].nodeId = nodeId;
+#endif
+
+    return nodeId;
 }
 
 void ReactGraph::UnregisterNode(NodeId nodeId)
 {
+#ifdef REACT_ENABLE_PROFILING
+    nodeProfiles_[nodeId] = NodeProfile{ };
+    nodeProfiles_[nodeId].nodeId = invalid_node_id;
+#endif
+
+    nodeStale_[nodeId].store(false, std::memory_order_relaxed);
+    nodeSuccessors_.Unregister(nodeId);
+    nodePredecessors_.Unregister(nodeId);
     nodeData_.Erase(nodeId);
 }
 
 void ReactGraph::AttachNode(NodeId nodeId, NodeId parentId)
 {
-    auto& node = nodeData_[nodeId];
-    auto& parent = nodeData_[parentId];
+    if (isInParallelPhase_)
+    {
+        parallelBuffers_.local().topologyRequests.push_back(TopologyRequest{ true, nodeId, parentId });
+        return;
+    }
+
+    nodeSuccessors_.Add(parentId, nodeId);
+    nodePredecessors_.Add(nodeId, parentId);
 
-    parent.successors.push_back(nodeId);
+    // Maintain the topological order incrementally. Only nodes that have to move are visited.
+    if (nodeLevels_[nodeId] <= nodeLevels_[parentId])
+    {
+        nodeLevels_[nodeId] = nodeLevels_[parentId] + 1;
+        RecalculateSuccessorLevels(nodeId);
+    }
 
-    if (node.level <= parent.level)
-        node.level = parent.level + 1;
+    if (nodeObservedCounts_[nodeId] > 0)
+    {
+        // Parent is observed through this node now. This refreshes it, if it was stale.
+        IncObservedCount(parentId);
+    }
+    else if (nodeStale_[parentId].load(std::memory_order_relaxed))
+    {
+        // Unobserved node has been initialized from a stale value.
+        MarkStale(nodeId);
+    }
 }
 
 void ReactGraph::DetachNode(NodeId nodeId, NodeId parentId)
 {
-    auto& parent = nodeData_[parentId];
-    auto& successors = parent.successors;
+    if (isInParallelPhase_)
+    {
+        parallelBuffers_.local().topologyRequests.push_back(TopologyRequest{ false, nodeId, parentId });
+        return;
+    }
+
+    nodeSuccessors_.Remove(parentId, nodeId);
+    nodePredecessors_.Remove(nodeId, parentId);
+
+    if (nodeObservedCounts_[nodeId] > 0)
+        DecObservedCount(parentId);
+}
+
+void ReactGraph::SetNodeWeightHint(NodeId nodeId, WeightHint weight)
+{
+    auto& node = nodeData_[nodeId];
+
+    node.weightHint = weight;
+    node.isHeavy = weight == WeightHint::heavy;
 
-    successors.erase(std::find(successors.begin(), successors.end(), nodeId));
+    // Start measuring from scratch.
+    node.updateCount = 0;
+    node.avgUpdateCost = 0.0f;
+}
+
+void ReactGraph::SetNodeName(NodeId nodeId, std::string name)
+{
+#ifdef REACT_ENABLE_PROFILING
+    nodeProfiles_[nodeId].name = std::move(name);
+#endif
+}
+
+std::vector<NodeProfile> ReactGraph::GetProfile() const
+{
+    std::vector<NodeProfile> result;
+
+#ifdef REACT_ENABLE_PROFILING
+    for (const NodeProfile& profile : nodeProfiles_)
+        if (profile.nodeId != invalid_node_id)
+            result.push_back(profile);
+#endif
+
+    return result;
+}
+
+void ReactGraph::ResetProfile()
+{
+#ifdef REACT_ENABLE_PROFILING
+    for (NodeProfile& profile : nodeProfiles_)
+    {
+        profile.updateCount = 0;
+        profile.changedCount = 0;
+        profile.unchangedCount = 0;
+        profile.shiftedCount = 0;
+        profile.updateTime = std::chrono::nanoseconds{ 0 };
+    }
+#endif
+}
+
+void ReactGraph::StartTrace()
+{
+#ifdef REACT_ENABLE_PROFILING
+    traceSink_.Start();
+#endif
+}
+
+void ReactGraph::StopTrace(std::ostream& out)
+{
+#ifdef REACT_ENABLE_PROFILING
+    traceSink_.Stop(out, [this] (NodeId nodeId) { return nodeProfiles_[nodeId].name; });
+#else
+    out << "{\"traceEvents\":[]}\n";
+#endif
+}
+
+void ReactGraph::SetNodePrunable(NodeId nodeId)
+{
+    auto& node = nodeData_[nodeId];
+
+    if (node.isPrunable)
+        return;
+
+    node.isPrunable = true;
+    DecObservedCount(nodeId);
+}
+
+void ReactGraph::SetPruningEnabled(bool enabled)
+{
+    if (isPruningEnabled_ == enabled)
+        return;
+
+    isPruningEnabled_ = enabled;
+
+    if (enabled)
+        return;
+
+    // Without pruning, every node has to be up-to-date again.
+    for (NodeId nodeId = 0; nodeId < nodeStale_.Size(); ++nodeId)
+        if (nodeStale_[nodeId].load(std::memory_order_relaxed))
+            refreshNodes_.push_back(nodeId);
+
+    RefreshStaleNodes(refreshNodes_);
 }
 
 void ReactGraph::AddSyncPointDependency(SyncPoint::Dependency dep, bool syncLinked)
@@ -66,37 +214,100 @@ void ReactGraph::AllowLinkedTransactionMerging(bool allowMerging)
 
 void ReactGraph::Propagate()
 {
+    REACT_TRACE_SCOPE(traceSink_, "turn", currentTurnId_);
+
+    // Stale nodes that became observed during the transaction are already scheduled. Pulsecount
+    // can't mix them with its own marking, so such a turn falls back to the topological queue.
+    bool isPulsecount = propagationMode_ == PropagationMode::pulsecount && scheduledNodes_.IsEmpty();
+
     // Fill update queue with successors of changed inputs.
     for (NodeId nodeId : changedInputs_)
     {
         auto& node = nodeData_[nodeId];
         auto* nodePtr = node.nodePtr;
 
-        UpdateResult res = nodePtr->Update(0u);
+        UpdateResult res = nodePtr->Update(currentTurnId_);
 
         if (res == UpdateResult::changed)
         {
-            changedNodes_.push_back(nodePtr);
-            ScheduleSuccessors(node);
+            // Pulsecount doesn't use the topological queue. Changed inputs are the roots to start from.
+            if (isPulsecount)
+                pulsecountRoots_.push_back(nodeId);
+            else
+                ScheduleSuccessors(nodeId);
         }
     }
 
     // Propagate changes.
+    switch (propagationMode_)
+    {
+#ifndef REACT_DISABLE_TBB
+    case PropagationMode::level_parallel:
+        PropagateLevelParallel();
+        break;
+    case PropagationMode::pulsecount:
+        if (isPulsecount)
+            PropagatePulsecount();
+        else
+            PropagateSequential();
+        break;
+    case PropagationMode::subtree:
+        PropagateSubtree();
+        break;
+#endif
+    default:
+        PropagateSequential();
+        break;
+    }
+
+    if (!scheduledLinkOutputs_.empty())
+        UpdateLinkNodes();
+
+    changedInputs_.clear();
+
+    // Clean link state.
+    scheduledLinkOutputs_.clear();
+    localDependencies_.clear();
+    linkDependencies_.clear();
+    allowLinkedTransactionMerging_ = false;
+
+    // Event buffers of this turn become stale from here on.
+    ++currentTurnId_;
+}
+
+void ReactGraph::PropagateSequential()
+{
     while (scheduledNodes_.FetchNext())
     {
+        int level = scheduledNodes_.NextLevel();
+
+        REACT_TRACE_SCOPE(traceSink_, "level", level);
+
         for (NodeId nodeId : scheduledNodes_.Next())
         {
-            auto& node = nodeData_[nodeId];
-            auto* nodePtr = node.nodePtr;
-
-            // A predecessor of this node has shifted to a lower level?
-            if (node.level < node.newLevel)
+            // Node has been moved to a higher level after it was scheduled?
+            if (nodeLevels_[nodeId] != level)
             {
                 // Re-schedule this node.
-                node.level = node.newLevel;
+                scheduledNodes_.Push(nodeId, nodeLevels_[nodeId]);
+                continue;
+            }
+
+            // Node has become part of a subtree that is updated in parallel afterwards?
+            if (nodeMarks_[nodeId].load(std::memory_order_relaxed) != NodeMark::unmarked)
+            {
+                nodeMarks_[nodeId].store(NodeMark::should_update, std::memory_order_relaxed);
+                nodeQueued_[nodeId] = false;
+                continue;
+            }
+
+            auto& node = nodeData_[nodeId];
 
-                RecalculateSuccessorLevels(node);
-                scheduledNodes_.Push(nodeId, node.level);
+            // Nothing depends on this node? Skip it until it's observed again.
+            if (ShouldPrune(nodeId))
+            {
+                MarkStale(nodeId);
+                nodeQueued_[nodeId] = false;
                 continue;
             }
 
@@ -104,47 +315,32 @@ void ReactGraph::Propagate()
             if (node.category == NodeCategory::linkoutput)
             {
                 node.nodePtr->CollectOutput(scheduledLinkOutputs_);
+                nodeQueued_[nodeId] = false;
                 continue;
             }
 
-            UpdateResult res = nodePtr->Update(0u);
+            UpdateResult res = UpdateNode(nodeId);
 
-            // Topology changed?
+            // Topology changed? Levels have already been updated by AttachNode.
             if (res == UpdateResult::shifted)
             {
                 // Re-schedule this node.
-                RecalculateSuccessorLevels(node);
-                scheduledNodes_.Push(nodeId, node.level);
+                scheduledNodes_.Push(nodeId, nodeLevels_[nodeId]);
                 continue;
             }
             
             if (res == UpdateResult::changed)
-            {
-                changedNodes_.push_back(nodePtr);
-                ScheduleSuccessors(node);
-            }
+                ScheduleSuccessors(nodeId);
 
-            node.queued = false;
+            nodeQueued_[nodeId] = false;
         }
     }
-
-    if (!scheduledLinkOutputs_.empty())
-        UpdateLinkNodes();
-
-    // Cleanup buffers in changed nodes.
-    for (IReactNode* nodePtr : changedNodes_)
-        nodePtr->Clear();
-    changedNodes_.clear();
-
-    // Clean link state.
-    scheduledLinkOutputs_.clear();
-    localDependencies_.clear();
-    linkDependencies_.clear();
-    allowLinkedTransactionMerging_ = false;
 }
 
 void ReactGraph::UpdateLinkNodes()
 {
+    REACT_TRACE_SCOPE(traceSink_, "link_outputs", scheduledLinkOutputs_.size());
+
     TransactionFlags flags = TransactionFlags::none;
 
     if (! linkDependencies_.empty())
@@ -157,7 +353,7 @@ void ReactGraph::UpdateLinkNodes()
 
     for (auto& e : scheduledLinkOutputs_)
     {
-        e.first->EnqueueTransaction(
+        e.first->GetTransactionQueue().PushLinked(
             [inputs = std::move(e.second)]
             {
                 for (auto& callback : inputs)
@@ -166,68 +362,509 @@ void ReactGraph::UpdateLinkNodes()
     }
 }
 
-void ReactGraph::ScheduleSuccessors(NodeData& node)
+void ReactGraph::ScheduleSuccessors(NodeId nodeId)
+{
+#ifndef REACT_DISABLE_TBB
+    if (propagationMode_ == PropagationMode::subtree)
+    {
+        ScheduleSubtreeSuccessors(nodeId);
+        return;
+    }
+#endif
+
+    for (NodeId succId : nodeSuccessors_.Get(nodeId))
+    {
+        if (!nodeQueued_[succId])
+        {
+            nodeQueued_[succId] = true;
+            scheduledNodes_.Push(succId, nodeLevels_[succId]);
+        }
+    }
+}
+
+void ReactGraph::RecalculateSuccessorLevels(NodeId nodeId)
 {
-    for (NodeId succId : node.successors)
+    // Move every reachable node that would end up at or below the level of a predecessor.
+    // The search stops at nodes that are already high enough.
+    searchStack_.push_back(nodeId);
+
+    while (! searchStack_.empty())
     {
-        auto& succ = nodeData_[succId];
+        NodeId curId = searchStack_.back();
+        searchStack_.pop_back();
+
+        int level = nodeLevels_[curId];
 
-        if (!succ.queued)
+        for (NodeId succId : nodeSuccessors_.Get(curId))
         {
-            succ.queued = true;
-            scheduledNodes_.Push(succId, succ.level);
+            if (nodeLevels_[succId] <= level)
+            {
+                nodeLevels_[succId] = level + 1;
+                searchStack_.push_back(succId);
+            }
         }
     }
 }
 
-void ReactGraph::RecalculateSuccessorLevels(NodeData& node)
+UpdateResult ReactGraph::UpdateNodeTimed(NodeData& node)
+{
+    using std::chrono::steady_clock;
+
+    auto t0 = steady_clock::now();
+    UpdateResult res = node.nodePtr->Update(currentTurnId_);
+    auto t1 = steady_clock::now();
+
+    float cost = static_cast<float>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+
+    RecordUpdateCost(node, cost);
+
+    return res;
+}
+
+void ReactGraph::RecordUpdateCost(NodeData& node, float cost)
+{
+    // The first sample initializes the average. Afterwards, older samples decay exponentially.
+    if (node.updateCount == 1)
+        node.avgUpdateCost = cost;
+    else
+        node.avgUpdateCost += (cost - node.avgUpdateCost) * 0.25f;
+
+    // Hysteresis, so nodes close to the threshold don't flip back and forth.
+    if (node.isHeavy)
+        node.isHeavy = node.avgUpdateCost > heavy_cost_threshold / 2;
+    else
+        node.isHeavy = node.avgUpdateCost > heavy_cost_threshold;
+}
+
+#ifdef REACT_ENABLE_PROFILING
+UpdateResult ReactGraph::UpdateNodeProfiled(NodeId nodeId)
+{
+    using std::chrono::steady_clock;
+
+    auto& node = nodeData_[nodeId];
+
+    auto t0 = steady_clock::now();
+    UpdateResult res = node.nodePtr->Update(currentTurnId_);
+    auto t1 = steady_clock::now();
+
+    // Each node is updated by one thread at a time, so no synchronization is needed.
+    NodeProfile& profile = nodeProfiles_[nodeId];
+
+    auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0);
+
+    ++profile.updateCount;
+    profile.updateTime += time;
+
+    if (res == UpdateResult::changed)
+        ++profile.changedCount;
+    else if (res == UpdateResult::unchanged)
+        ++profile.unchangedCount;
+    else
+        ++profile.shiftedCount;
+
+    if (traceSink_.IsActive())
+        traceSink_.Complete(node.category == NodeCategory::output ? "observer" : "update", nodeId, 0, t0, t1);
+
+    // Every update is timed anyway, so the sample for automatic nodes comes for free.
+    if (node.weightHint == WeightHint::automatic && (node.updateCount++ % cost_sample_interval) == 0)
+        RecordUpdateCost(node, static_cast<float>(time.count()));
+
+    return res;
+}
+#endif
+
+bool ReactGraph::TryAcquireOwnership()
+{
+    bool expected = false;
+
+    if (! isOwned_.compare_exchange_strong(expected, true))
+        return false;
+
+    ownerThread_.store(std::this_thread::get_id());
+    return true;
+}
+
+void ReactGraph::AcquireOwnership()
+{
+    while (! TryAcquireOwnership())
+        std::this_thread::yield();
+}
+
+void ReactGraph::ReleaseOwnership()
+{
+    ownerThread_.store(std::thread::id{ });
+    isOwned_.store(false);
+}
+
+void ReactGraph::ApplyBufferedInputs()
+{
+    InputBuffer::Input* input = inputBuffer_.PopAll();
+
+    while (input != nullptr)
+    {
+        InputBuffer::Input* next = input->next;
+
+        input->Apply();
+        changedInputs_.push_back(input->nodeId);
+
+        delete input;
+        input = next;
+    }
+}
+
+void ReactGraph::DrainInputs()
+{
+    // Inputs that were pushed while another thread owned the graph are propagated in batches.
+    // The buffer is checked again after each release, so an input that was pushed right before the
+    // owner released the graph isn't left behind.
+    while (! inputBuffer_.IsEmpty() && TryAcquireOwnership())
+    {
+        ApplyBufferedInputs();
+
+        if (! changedInputs_.empty())
+            Propagate();
+
+        ReleaseOwnership();
+    }
+}
+
+void ReactGraph::MarkStale(NodeId nodeId)
 {
-    for (NodeId succId : node.successors)
+    // Everything that depends on a stale node is stale as well. Already stale nodes don't have to
+    // be visited again, so each node is only marked once until it's refreshed.
+    if (nodeStale_[nodeId].exchange(true, std::memory_order_relaxed))
+        return;
+
+    searchStack_.push_back(nodeId);
+
+    while (! searchStack_.empty())
+    {
+        NodeId curId = searchStack_.back();
+        searchStack_.pop_back();
+
+        for (NodeId succId : nodeSuccessors_.Get(curId))
+            if (! nodeStale_[succId].exchange(true, std::memory_order_relaxed))
+                searchStack_.push_back(succId);
+    }
+}
+
+void ReactGraph::IncObservedCount(NodeId nodeId)
+{
+    searchStack_.push_back(nodeId);
+
+    while (! searchStack_.empty())
+    {
+        NodeId curId = searchStack_.back();
+        searchStack_.pop_back();
+
+        if (nodeObservedCounts_[curId]++ != 0)
+            continue;
+
+        // Node has become observed, so its predecessors are observed as well.
+        if (nodeStale_[curId].load(std::memory_order_relaxed))
+            refreshNodes_.push_back(curId);
+
+        for (NodeId predId : nodePredecessors_.Get(curId))
+            searchStack_.push_back(predId);
+    }
+
+    if (! refreshNodes_.empty())
+        RefreshStaleNodes(refreshNodes_);
+}
+
+void ReactGraph::DecObservedCount(NodeId nodeId)
+{
+    searchStack_.push_back(nodeId);
+
+    while (! searchStack_.empty())
     {
-        auto& succ = nodeData_[succId];
+        NodeId curId = searchStack_.back();
+        searchStack_.pop_back();
+
+        if (--nodeObservedCounts_[curId] != 0)
+            continue;
 
-        if (succ.newLevel <= node.level)
-            succ.newLevel = node.level + 1;
+        for (NodeId predId : nodePredecessors_.Get(curId))
+            searchStack_.push_back(predId);
     }
 }
 
+void ReactGraph::RefreshStaleNodes(std::vector<NodeId>& nodes)
+{
+    // Inputs of an open transaction haven't been propagated yet. Updating now would update the
+    // nodes again during propagation, so they are scheduled for the upcoming turn instead.
+    if (transactionLevel_ > 0)
+    {
+        for (NodeId nodeId : nodes)
+        {
+            nodeStale_[nodeId].store(false, std::memory_order_relaxed);
+
+            if (! nodeQueued_[nodeId].exchange(true, std::memory_order_relaxed))
+                scheduledNodes_.Push(nodeId, nodeLevels_[nodeId]);
+        }
+
+        nodes.clear();
+        return;
+    }
+
+    // All stale predecessors of a stale node are in the list as well, so updating them in level
+    // order is enough.
+    std::sort(nodes.begin(), nodes.end(), [this] (NodeId a, NodeId b)
+        { return nodeLevels_[a] < nodeLevels_[b]; });
+
+    for (NodeId nodeId : nodes)
+    {
+        nodeStale_[nodeId].store(false, std::memory_order_relaxed);
+
+        // Already scheduled in the current turn? Then it's updated anyway.
+        if (nodeQueued_[nodeId].load(std::memory_order_relaxed))
+            continue;
+
+        nodeData_[nodeId].nodePtr->Update(currentTurnId_);
+    }
+
+    nodes.clear();
+}
+
+void ReactGraph::ReserveNodeArrays(size_t size)
+{
+    size_t newSize = (std::max)(size, nodeLevels_.size() * 2);
+
+    nodeLevels_.resize(newSize, 0);
+    nodeQueued_.Resize(newSize, false);
+    nodePendingCounts_.Resize(newSize, 0);
+    nodeMarks_.Resize(newSize, NodeMark::unmarked);
+    nodeObservedCounts_.resize(newSize, 0);
+    nodeStale_.Resize(newSize, false);
+
+#ifdef REACT_ENABLE_PROFILING
+    NodeProfile unused;
+    unused.nodeId = invalid_node_id;
+    nodeProfiles_.resize(newSize, unused);
+#endif
+}
+
+void ReactGraph::AdjacencyArena::Register(NodeId nodeId)
+{
+    if (nodeId >= slices_.size())
+        slices_.resize((std::max)(nodeId + 1, slices_.size() * 2));
+
+    slices_[nodeId] = Slice{ };
+}
+
+void ReactGraph::AdjacencyArena::Unregister(NodeId nodeId)
+{
+    Slice& s = slices_[nodeId];
+
+    unusedCount_ += s.capacity;
+    s = Slice{ };
+}
+
+void ReactGraph::AdjacencyArena::Add(NodeId nodeId, NodeId succId)
+{
+    static const uint initial_capacity = 4;
+
+    Slice& s = slices_[nodeId];
+
+    // Full? Move slice to the end of the arena.
+    if (s.count == s.capacity)
+    {
+        uint newCapacity = s.capacity == 0 ? initial_capacity : s.capacity * 2;
+        size_t newOffset = data_.size();
+
+        data_.resize(newOffset + newCapacity);
+        std::copy(data_.begin() + s.offset, data_.begin() + s.offset + s.count, data_.begin() + newOffset);
+
+        unusedCount_ += s.capacity;
+        s.offset = newOffset;
+        s.capacity = newCapacity;
+
+        if (unusedCount_ > data_.size() / 2)
+            Compact();
+    }
+
+    data_[s.offset + s.count] = succId;
+    ++s.count;
+}
+
+void ReactGraph::AdjacencyArena::Remove(NodeId nodeId, NodeId succId)
+{
+    Slice& s = slices_[nodeId];
+
+    auto first = data_.begin() + s.offset;
+    auto last = first + s.count;
+
+    // Keep the order of remaining successors.
+    auto it = std::find(first, last, succId);
+    std::copy(it + 1, last, it);
+    --s.count;
+}
+
+void ReactGraph::AdjacencyArena::Compact()
+{
+    std::vector<NodeId> newData;
+    newData.reserve(data_.size() - unusedCount_);
+
+    for (Slice& s : slices_)
+    {
+        if (s.capacity == 0)
+            continue;
+
+        size_t newOffset = newData.size();
+
+        newData.insert(newData.end(), data_.begin() + s.offset, data_.begin() + s.offset + s.count);
+        newData.resize(newOffset + s.capacity);
+
+        s.offset = newOffset;
+    }
+
+    data_ = std::move(newData);
+    unusedCount_ = 0;
+}
+
+ReactGraph::InputBuffer::~InputBuffer()
+{
+    Input* input = PopAll();
+
+    while (input != nullptr)
+    {
+        Input* next = input->next;
+        delete input;
+        input = next;
+    }
+}
+
+void ReactGraph::InputBuffer::Push(Input* input)
+{
+    input->next = head_.load();
+
+    while (! head_.compare_exchange_weak(input->next, input))
+        ;
+}
+
+ReactGraph::InputBuffer::Input* ReactGraph::InputBuffer::PopAll()
+{
+    Input* head = head_.exchange(nullptr);
+
+    // The list is LIFO. Reverse it, so inputs of the same thread are applied in order.
+    Input* result = nullptr;
+
+    while (head != nullptr)
+    {
+        Input* next = head->next;
+        head->next = result;
+        result = head;
+        head = next;
+    }
+
+    return result;
+}
+
+void ReactGraph::TopoQueue::Push(NodeId nodeId, int level)
+{
+    size_t index = static_cast<size_t>(level);
+
+    if (index >= buckets_.size())
+        buckets_.resize(index + 1);
+
+    buckets_[index].push_back(nodeId);
+    ++count_;
+
+    // Re-scheduled nodes can end up below the current min level.
+    if (minLevel_ > level)
+        minLevel_ = level;
+}
+
 bool ReactGraph::TopoQueue::FetchNext()
 {
     // Throw away previous values
     nextData_.clear();
 
-    // Find min level of nodes in queue data
-    minLevel_ = (std::numeric_limits<int>::max)();
-    for (const auto& e : queueData_)
-        if (minLevel_ > e.second)
-            minLevel_ = e.second;
+    if (count_ == 0)
+    {
+        minLevel_ = (std::numeric_limits<int>::max)();
+        return false;
+    }
+
+    // Skip empty buckets until the next non-empty level is found
+    while (buckets_[minLevel_].empty())
+        ++minLevel_;
+
+    // Swap bucket contents with next data. This recycles the capacity of the previous next data.
+    nextData_.swap(buckets_[minLevel_]);
+    nextLevel_ = minLevel_;
+    count_ -= nextData_.size();
+
+    return true;
+}
+
+void TransactionQueue::WaitForPending()
+{
+    // Lanes complete in the order they were pushed, so it's enough to wait for the last position.
+    // Counters are only incremented after a batch has been propagated, so this also waits for the
+    // work that follows the last sync point of a batch.
+    for (size_t i = 0; i < lane_count; ++i)
+    {
+        size_t pushedCount = lanes_[i].WritePosition();
 
-    // Swap entries with min level to the end
-    auto p = std::partition(queueData_.begin(), queueData_.end(), [t = minLevel_] (const Entry& e) { return t != e.second; });
+        if (pushedCount != 0)
+            completedCounts_[i].WaitUntilAbove(pushedCount - 1);
 
-    // Move min level values to next data
-    nextData_.reserve(std::distance(p, queueData_.end()));
+        size_t spilledCount;
 
-    for (auto it = p; it != queueData_.end(); ++it)
-        nextData_.push_back(it->first);
+        {
+            std::lock_guard<std::mutex> lock(overflows_[i].mutex);
+            spilledCount = overflows_[i].pushedCount;
+        }
 
-    // Truncate moved entries
-    queueData_.resize(std::distance(queueData_.begin(), p));
+        if (spilledCount != 0)
+            overflows_[i].completedCount.WaitUntilAbove(spilledCount - 1);
+    }
+}
 
-    return !nextData_.empty();
+void TransactionQueue::PostWorker()
+{
+    executor_->Post([this, graphPtr = graph_.shared_from_this()] { ProcessQueue(); });
 }
 
 void TransactionQueue::ProcessQueue()
 {
+    auto timeSlice = executor_->GetTimeSlice();
+
+    if (timeSlice.count() > 0)
+        ProcessQueue(ClockType::now() + timeSlice);
+    else
+        ProcessQueue(ClockType::time_point::max());
+}
+
+void TransactionQueue::ProcessQueue(ClockType::time_point deadline)
+{
+    workerThread_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
     for (;;)
     {
-        size_t popCount = ProcessNextBatch();
-        if (count_.fetch_sub(popCount) == popCount)
+        size_t popCount = ProcessNextBatch(deadline);
+
+        // Cleared before the last decrement. Once it's done, the next worker may already be running.
+        if (count_.load(std::memory_order_relaxed) == popCount)
+            workerThread_.store(std::thread::id{ }, std::memory_order_relaxed);
+
+        if (count_.fetch_sub(popCount, std::memory_order_release) == popCount)
+            return;
+
+        // Time slice is used up, but there's more work. Let the executor decide what runs next.
+        if (ClockType::now() >= deadline)
+        {
+            workerThread_.store(std::thread::id{ }, std::memory_order_relaxed);
+            PostWorker();
             return;
+        }
+
+        workerThread_.store(std::this_thread::get_id(), std::memory_order_relaxed);
     }
 }
 
-size_t TransactionQueue::ProcessNextBatch()
+size_t TransactionQueue::ProcessNextBatch(ClockType::time_point deadline)
 {
     StoredTransaction curTransaction;
     size_t popCount = 0;
@@ -238,12 +875,14 @@ size_t TransactionQueue::ProcessNextBatch()
     bool skipPop = false;
     bool isDone = false;
 
+    size_t lane = 0;
+
     // Outer loop. One transaction per iteration.
     for (;;)
     {
         if (!skipPop)
         {
-            if (!transactions_.try_pop(curTransaction))
+            if (!TryPopNext(curTransaction, lane))
                 return popCount;
 
             canMerge = IsBitmaskSet(curTransaction.flags, TransactionFlags::allow_merging);
@@ -256,8 +895,25 @@ size_t TransactionQueue::ProcessNextBatch()
             skipPop = false;
         }
 
+        size_t mergeStart = popCount;
+
+        auto t0 = ClockType::now();
+
+        size_t batchLimit = GetBatchLimit();
+        size_t batchSize = 1;
+        bool isFull = false;
+
+        // Number of transactions in this batch that have tickets.
+        size_t ticketCount = curTransaction.isSpilled ? 0 : 1;
+
+        // Only wait for more transactions if the batch could grow.
+        bool shouldLinger = coalescing_.linger.count() > 0 && batchLimit > 1;
+        // Lingering doesn't extend the time slice.
+        auto lingerDeadline = (std::min)(t0 + coalescing_.linger, deadline);
+
         graph_.DoTransaction([&]
         {
+            RecordStart(curTransaction);
             curTransaction.func();
             graph_.AddSyncPointDependency(std::move(curTransaction.dep), syncLinked);
 
@@ -265,11 +921,27 @@ size_t TransactionQueue::ProcessNextBatch()
             {
                 graph_.AllowLinkedTransactionMerging(true);
 
-                // Pull in additional mergeable transactions.
+                // Pull in additional mergeable transactions of the same lane.
+                // Stop once there's anything of higher priority, so it doesn't have to wait.
                 for (;;)
                 {
-                    if (!transactions_.try_pop(curTransaction))
-                        return;
+                    if (batchSize >= batchLimit)
+                    {
+                        // Only full if the queue actually had more to merge.
+                        isFull = HasMergeableWork(lane);
+                        break;
+                    }
+
+                    if (HasWorkAbove(lane))
+                        break;
+
+                    if (!TryPop(lane, curTransaction))
+                    {
+                        if (shouldLinger && WaitForWork(lane, lingerDeadline))
+                            continue;
+
+                        break;
+                    }
 
                     canMerge = IsBitmaskSet(curTransaction.flags, TransactionFlags::allow_merging);
                     syncLinked = IsBitmaskSet(curTransaction.flags, TransactionFlags::sync_linked);
@@ -279,15 +951,187 @@ size_t TransactionQueue::ProcessNextBatch()
                     if (!canMerge)
                     {
                         skipPop = true;
-                        return;
+                        break;
                     }
 
+                    RecordStart(curTransaction);
                     curTransaction.func();
                     graph_.AddSyncPointDependency(std::move(curTransaction.dep), syncLinked);
+
+                    ++batchSize;
+
+                    if (!curTransaction.isSpilled)
+                        ++ticketCount;
                 }
+
+                // Adapt before the turn is propagated, which releases the sync points of the batch.
+                if (coalescing_.isAdaptive)
+                    AdaptBatchSize(batchSize, isFull);
             }
         });
+
+        completedCounts_[lane].Add(ticketCount);
+
+        if (batchSize != ticketCount)
+            overflows_[lane].completedCount.Add(batchSize - ticketCount);
+
+        auto t1 = ClockType::now();
+
+        // The transaction that stopped merging is not part of this turn.
+        size_t mergedCount = popCount - mergeStart + (skipPop ? 0 : 1);
+
+        executionTime_.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        mergeBatchSize_.Record(mergedCount);
+
+        REACT_TRACE_COUNTER(graph_.GetTraceSink(), "merged_transactions", mergedCount);
+
+        // A transaction that stopped merging has already been popped, so it has to be run first.
+        if (!skipPop && t1 >= deadline)
+            return popCount;
+    }
+}
+
+void TransactionQueue::Spill(size_t lane, StoredTransaction&& transaction)
+{
+    auto& overflow = overflows_[lane];
+
+    transaction.isSpilled = true;
+
+    std::lock_guard<std::mutex> lock(overflow.mutex);
+    overflow.entries.push_back(Overflow::Entry{ lanes_[lane].WritePosition(), std::move(transaction) });
+    ++overflow.pushedCount;
+    overflow.count.fetch_add(1, std::memory_order_release);
+}
+
+bool TransactionQueue::TryPopNext(StoredTransaction& transaction, size_t& lane)
+{
+    for (size_t i = 0; i < lane_count; ++i)
+    {
+        if (TryPop(i, transaction))
+        {
+            lane = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TransactionQueue::TryPop(size_t lane, StoredTransaction& transaction)
+{
+    auto& overflow = overflows_[lane];
+
+    if (overflow.count.load(std::memory_order_acquire) != 0)
+    {
+        std::lock_guard<std::mutex> lock(overflow.mutex);
+
+        if (overflow.entries.front().position <= lanes_[lane].ReadPosition())
+        {
+            transaction = std::move(overflow.entries.front().transaction);
+            overflow.entries.pop_front();
+            overflow.count.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return lanes_[lane].TryPop(transaction);
+}
+
+const TransactionQueue::StoredTransaction* TransactionQueue::Peek(size_t lane)
+{
+    auto& overflow = overflows_[lane];
+
+    if (overflow.count.load(std::memory_order_acquire) != 0)
+    {
+        // Entries are only removed by the worker, so the reference stays valid.
+        std::lock_guard<std::mutex> lock(overflow.mutex);
+
+        if (overflow.entries.front().position <= lanes_[lane].ReadPosition())
+            return &overflow.entries.front().transaction;
+    }
+
+    return lanes_[lane].Peek();
+}
+
+bool TransactionQueue::IsEmpty(size_t lane) const
+{
+    return lanes_[lane].IsEmpty() && overflows_[lane].count.load(std::memory_order_acquire) == 0;
+}
+
+bool TransactionQueue::HasWorkAbove(size_t lane) const
+{
+    for (size_t i = 0; i < lane; ++i)
+        if (! IsEmpty(i))
+            return true;
+
+    return false;
+}
+
+bool TransactionQueue::HasMergeableWork(size_t lane)
+{
+    const StoredTransaction* next = Peek(lane);
+    return next != nullptr && IsBitmaskSet(next->flags, TransactionFlags::allow_merging);
+}
+
+size_t TransactionQueue::GetBatchLimit() const
+{
+    if (coalescing_.isAdaptive)
+        return adaptiveBatchSize_;
+    else if (coalescing_.maxBatchSize != 0)
+        return coalescing_.maxBatchSize;
+    else
+        return (std::numeric_limits<size_t>::max)();
+}
+
+void TransactionQueue::AdaptBatchSize(size_t batchSize, bool isFull)
+{
+    size_t maxSize = coalescing_.maxBatchSize != 0 ? coalescing_.maxBatchSize : max_adaptive_batch_size;
+
+    // The queue is deeper than the batch size. Grow, so more transactions share a turn.
+    if (isFull)
+        adaptiveBatchSize_ = (std::min)(adaptiveBatchSize_ * 2, maxSize);
+    // Less than half was used. Shrink, so single transactions don't linger.
+    else if (batchSize * 2 <= adaptiveBatchSize_)
+        adaptiveBatchSize_ = (std::max)(adaptiveBatchSize_ / 2, size_t(1));
+}
+
+bool TransactionQueue::WaitForWork(size_t lane, ClockType::time_point deadline) const
+{
+    while (IsEmpty(lane))
+    {
+        if (HasWorkAbove(lane) || ClockType::now() >= deadline)
+            return false;
+
+        std::this_thread::yield();
     }
+
+    return true;
+}
+
+void TransactionQueue::RecordStart(const StoredTransaction& transaction)
+{
+    auto latency = ClockType::now() - transaction.enqueueTime;
+    enqueueLatency_.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+}
+
+TransactionStats TransactionQueue::GetStats() const
+{
+    TransactionStats stats;
+
+    stats.enqueueLatency = enqueueLatency_.Snapshot();
+    stats.executionTime = executionTime_.Snapshot();
+    stats.mergeBatchSize = mergeBatchSize_.Snapshot();
+    stats.queueDepth = queueDepth_.Snapshot();
+
+    return stats;
+}
+
+void TransactionQueue::ResetStats()
+{
+    enqueueLatency_.Reset();
+    executionTime_.Reset();
+    mergeBatchSize_.Reset();
+    queueDepth_.Reset();
 }
 
 /****************************************/ REACT_IMPL_END /***************************************/
\ No newline at end of file
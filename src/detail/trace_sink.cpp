@@ -0,0 +1,140 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "react/detail/defs.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "react/detail/trace_sink.h"
+
+/***************************************/ REACT_IMPL_BEGIN /**************************************/
+
+static void WriteJsonString(std::ostream& out, const char* str)
+{
+    out << '"';
+
+    for (; *str != '\0'; ++str)
+    {
+        char c = *str;
+
+        if (c == '"' || c == '\\')
+        {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+            out << buf;
+        }
+        else
+        {
+            out << c;
+        }
+    }
+
+    out << '"';
+}
+
+static void WriteMicroseconds(std::ostream& out, int64_t ns)
+{
+    // Trace viewers expect microseconds. Keep the sub-microsecond part, since most updates are short.
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%lld.%03lld", static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+    out << buf;
+}
+
+void TraceSink::Start()
+{
+    for (ThreadBuffer& buffer : threadBuffers_)
+        buffer.events.clear();
+
+    startTime_ = ClockType::now();
+    isActive_.store(true, std::memory_order_relaxed);
+}
+
+void TraceSink::Stop(std::ostream& out, const NameLookup& lookup)
+{
+    isActive_.store(false, std::memory_order_relaxed);
+
+    out << "{\"traceEvents\":[";
+
+    bool isFirst = true;
+
+    for (ThreadBuffer& buffer : threadBuffers_)
+    {
+        for (const TraceEvent& e : buffer.events)
+        {
+            if (! isFirst)
+                out << ",";
+            isFirst = false;
+
+            out << "\n{\"name\":";
+            WriteJsonString(out, e.name);
+            out << ",\"cat\":\"react\",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":" << buffer.threadIndex << ",\"ts\":";
+            WriteMicroseconds(out, e.timestamp);
+
+            if (e.phase == 'X')
+            {
+                out << ",\"dur\":";
+                WriteMicroseconds(out, e.duration);
+            }
+
+            out << ",\"args\":{";
+
+            if (e.phase == 'C')
+            {
+                WriteJsonString(out, e.name);
+                out << ":" << e.value;
+            }
+            else if (e.nodeId != invalid_node_id)
+            {
+                out << "\"node\":" << e.nodeId;
+
+                std::string name = lookup ? lookup(e.nodeId) : std::string{ };
+                if (! name.empty())
+                {
+                    out << ",\"label\":";
+                    WriteJsonString(out, name.c_str());
+                }
+            }
+            else
+            {
+                out << "\"value\":" << e.value;
+            }
+
+            out << "}}";
+        }
+
+        buffer.events.clear();
+    }
+
+    out << "\n]}\n";
+}
+
+void TraceSink::Complete(const char* name, NodeId nodeId, size_t value, TimePoint start, TimePoint end)
+{
+    int64_t ts = ToNanoseconds(start);
+    LocalBuffer().events.push_back(TraceEvent{ name, 'X', nodeId, value, ts, ToNanoseconds(end) - ts });
+}
+
+void TraceSink::Counter(const char* name, size_t value)
+{
+    LocalBuffer().events.push_back(TraceEvent{ name, 'C', invalid_node_id, value, ToNanoseconds(ClockType::now()), 0 });
+}
+
+TraceSink::ThreadBuffer& TraceSink::LocalBuffer()
+{
+    ThreadBuffer& buffer = threadBuffers_.local();
+
+    // Thread ids in the trace are assigned in order of first use.
+    if (buffer.threadIndex == 0)
+        buffer.threadIndex = threadCount_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    return buffer;
+}
+
+/****************************************/ REACT_IMPL_END /***************************************/
@@ -1,17 +1,19 @@
-
 //          Copyright Sebastian Jeckel 2017.
 // Distributed under the Boost Software License, Version 1.0.
 //    (See accompanying file LICENSE_1_0.txt or copy at
 //          http://www.boost.org/LICENSE_1_0.txt)
 
-#if 0
-
-#include "react/engine/PulsecountEngine.h"
+#include "react/detail/defs.h"
 
-#include <cstdint>
+#include <algorithm>
 #include <utility>
+#include <vector>
+
+#include <tbb/task_group.h>
 
-#include "react/common/Types.h"
+#include "react/common/nodebuffer.h"
+#include "react/detail/graph_interface.h"
+#include "react/detail/graph_impl.h"
 
 /***************************************/ REACT_IMPL_BEGIN /**************************************/
 namespace pulsecount {
@@ -19,270 +21,231 @@ namespace pulsecount {
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 /// Constants
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-static const uint chunk_size    = 8;
-static const uint dfs_threshold = 3;
+static const size_t chunk_size      = 8;
+static const size_t dfs_threshold   = 3;
+
+using BufferT = NodeBuffer<NodeId, chunk_size>;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 /// MarkerTask
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-class MarkerTask: public task
+class MarkerTask
 {
 public:
-    using BufferT = NodeBuffer<Node,chunk_size>;
-
-    template <typename TInput>
-    MarkerTask(TInput srcBegin, TInput srcEnd) :
-        nodes_( srcBegin, srcEnd )
-    {}
+    MarkerTask(ReactGraph& graph, tbb::task_group& tasks, const BufferT& nodes) :
+        graph_( graph ),
+        tasks_( tasks ),
+        nodes_( nodes )
+    { }
 
-    MarkerTask(MarkerTask& other, SplitTag) :
-        nodes_( other.nodes_, SplitTag( ) )
-    {}
-
-    task* execute()
+    void operator()() const
     {
-        uint splitCount = 0;
+        BufferT nodes = nodes_;
+        ReactGraph::ParallelBuffer& buffer = graph_.parallelBuffers_.local();
+
+        size_t splitCount = 0;
 
-        while (! nodes_.IsEmpty())
+        while (! nodes.IsEmpty())
         {
-            Node& node = splitCount > dfs_threshold ? *nodes_.PopBack() : *nodes_.PopFront();
+            NodeId nodeId = splitCount > dfs_threshold ? nodes.PopBack() : nodes.PopFront();
 
-            // Increment counter of each successor and add it to smaller stack
-            for (auto* succ : node.Successors)
+            // Increment counter of each successor and add it to the work list if it's new.
+            for (NodeId succId : graph_.nodeSuccessors_.Get(nodeId))
             {
-                succ->IncCounter();
+                graph_.nodePendingCounts_[succId].fetch_add(1, std::memory_order_relaxed);
 
-                // Skip if already marked as reachable
-                if (! succ->ExchangeMark(ENodeMark::visited))
+                // Skip if already marked as reachable.
+                if (graph_.nodeMarks_[succId].exchange(ReactGraph::NodeMark::visited, std::memory_order_relaxed) != ReactGraph::NodeMark::unmarked)
                     continue;
-                
-                nodes_.PushBack(succ);
 
-                if (nodes_.IsFull())
-                {
-                    splitCount++;
+                buffer.markedNodes.push_back(succId);
+                nodes.PushBack(succId);
 
-                    //Delegate half the work to new task
-                    auto& t = *new(task::allocate_additional_child_of(*parent()))
-                        MarkerTask(*this, SplitTag{});
-
-                    spawn(t);
+                // Delegate half the work to a new task.
+                if (nodes.IsFull())
+                {
+                    ++splitCount;
+                    tasks_.run(MarkerTask(graph_, tasks_, BufferT(nodes, SplitTag{ })));
                 }
             }
         }
-
-        return nullptr;
     }
 
 private:
-    BufferT  nodes_;
+    ReactGraph&         graph_;
+    tbb::task_group&    tasks_;
+    BufferT             nodes_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 /// UpdaterTask
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-class UpdaterTask: public task
+class UpdaterTask
 {
 public:
-    using BufferT = NodeBuffer<Node,chunk_size>;
-
-    template <typename TInput>
-    UpdaterTask(Turn& turn, TInput srcBegin, TInput srcEnd) :
-        turn_( turn ),
-        nodes_( srcBegin, srcEnd )
-    {}
-
-    UpdaterTask(Turn& turn, Node* node) :
-        turn_( turn ),
-        nodes_( node )
-    {}
+    UpdaterTask(ReactGraph& graph, tbb::task_group& tasks, const BufferT& nodes) :
+        graph_( graph ),
+        tasks_( tasks ),
+        nodes_( nodes )
+    { }
 
-    UpdaterTask(UpdaterTask& other, SplitTag) :
-        turn_( other.turn_ ),
-        nodes_( other.nodes_, SplitTag( ) )
-    {}
-
-    task* execute()
+    void operator()() const
     {
-        uint splitCount = 0;
+        using NodeMark = ReactGraph::NodeMark;
 
-        while (!nodes_.IsEmpty())
-        {
-            Node& node = splitCount > dfs_threshold ? *nodes_.PopBack() : *nodes_.PopFront();
+        BufferT nodes = nodes_;
+        ReactGraph::ParallelBuffer& buffer = graph_.parallelBuffers_.local();
 
-            if (node.Mark() == ENodeMark::should_update)
-                node.Tick(&turn_);
+        size_t splitCount = 0;
 
-            // Defer if node was dynamically attached to a predecessor that
-            // has not pulsed yet
-            if (node.State == ENodeState::dyn_defer)
-                continue;
-
-            // Repeat the update if a node was dynamically attached to a
-            // predecessor that has already pulsed
-            while (node.State == ENodeState::dyn_repeat)
-                node.Tick(&turn_);
-
-            // Mark successors for update?
-            bool update = node.State == ENodeState::changed;
-            node.State = ENodeState::unchanged;
+        while (! nodes.IsEmpty())
+        {
+            NodeId nodeId = splitCount > dfs_threshold ? nodes.PopBack() : nodes.PopFront();
+            auto& node = graph_.nodeData_[nodeId];
 
-            {// node.ShiftMutex
-                Node::ShiftMutexT::scoped_lock lock(node.ShiftMutex, false);
+            NodeMark mark = graph_.nodeMarks_[nodeId].load(std::memory_order_relaxed);
+            bool changed = false;
 
-                for (auto* succ : node.Successors)
+            // Only the roots are unmarked. They have already been updated during the input phase.
+            if (mark == NodeMark::unmarked)
+            {
+                changed = true;
+            }
+            else if (mark == NodeMark::should_update)
+            {
+                if (graph_.ShouldPrune(nodeId))
+                {
+                    // Nothing depends on this node. Its successors are skipped as well.
+                    buffer.prunedNodes.push_back(nodeId);
+                }
+                else if (node.category == NodeCategory::linkoutput)
+                {
+                    // Link outputs write to a shared map, so they are collected after the phase.
+                    buffer.linkOutputNodes.push_back(nodeId);
+                }
+                else
                 {
-                    if (update)
-                        succ->SetMark(ENodeMark::should_update);
+                    UpdateResult res = graph_.UpdateNode(nodeId);
 
-                    // Delay tick?
-                    if (succ->DecCounter())
+                    // Topology changed? Stop here. The successors of this node will stall and are
+                    // finished by the sequential fallback.
+                    if (res == UpdateResult::shifted)
+                    {
+                        graph_.nodeQueued_[nodeId].store(true, std::memory_order_relaxed);
+                        buffer.shiftedNodes.push_back(nodeId);
                         continue;
+                    }
 
-                    // Heavyweight - spawn new task
-                    if (succ->IsHeavyweight())
-                    {
-                        auto& t = *new(task::allocate_additional_child_of(*parent()))
-                            UpdaterTask(turn_, succ);
+                    changed = res == UpdateResult::changed;
+                }
+            }
 
-                        spawn(t);
-                    }
-                    // Leightweight - add to buffer, split if full
-                    else
-                    {
-                        nodes_.PushBack(succ);
+            graph_.nodeMarks_[nodeId].store(NodeMark::unmarked, std::memory_order_relaxed);
 
-                        if (nodes_.IsFull())
-                        {
-                            splitCount++;
+            for (NodeId succId : graph_.nodeSuccessors_.Get(nodeId))
+            {
+                if (changed)
+                    graph_.nodeMarks_[succId].store(NodeMark::should_update, std::memory_order_relaxed);
 
-                            //Delegate half the work to new task
-                            auto& t = *new(task::allocate_additional_child_of(*parent()))
-                                UpdaterTask(*this, SplitTag{});
+                // Wait for the remaining predecessors?
+                if (graph_.nodePendingCounts_[succId].fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    continue;
 
-                            spawn(t);
-                        }
-                    }
+                // Heavyweight - spawn new task.
+                if (graph_.nodeData_[succId].isHeavy)
+                {
+                    tasks_.run(UpdaterTask(graph_, tasks_, BufferT(succId)));
+                    continue;
                 }
 
-                node.SetMark(ENodeMark::unmarked);
-            }// ~node.ShiftMutex
-        }
+                nodes.PushBack(succId);
 
-        return nullptr;
+                // Delegate half the work to a new task.
+                if (nodes.IsFull())
+                {
+                    ++splitCount;
+                    tasks_.run(UpdaterTask(graph_, tasks_, BufferT(nodes, SplitTag{ })));
+                }
+            }
+        }
     }
 
 private:
-    Turn&   turn_;
-    BufferT nodes_;
+    ReactGraph&         graph_;
+    tbb::task_group&    tasks_;
+    BufferT             nodes_;
 };
 
+} // ~namespace pulsecount
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-/// Turn
-///////////////////////////////////////////////////////////////////////////////////////////////////
-Turn::Turn(TurnIdT id, TransactionFlagsT flags) :
-    TurnBase( id, flags )
-{}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////
-/// PulsecountEngine
+/// Pulsecount
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-
-void EngineBase::AttachNode(Node& node, Node& parent)
+void ReactGraph::PropagatePulsecount()
 {
-    parent.Successors.Add(node);
-}
+    using pulsecount::BufferT;
+    using pulsecount::chunk_size;
 
-void EngineBase::DetachNode(Node& node, Node& parent)
-{
-    parent.Successors.Remove(node);
-}
+    if (pulsecountRoots_.empty())
+        return;
 
-void EngineBase::OnInputChange(Node& node, Turn& turn)
-{
-    changedInputs_.push_back(&node);
-    node.State = ENodeState::changed;
-}
+    REACT_TRACE_SCOPE(traceSink_, "pulsecount", pulsecountRoots_.size());
 
-template <typename TTask, typename TIt, typename ... TArgs>
-void spawnTasks
-(
-    task& rootTask, task_list& spawnList,
-    const size_t count, TIt start, TIt end,
-    TArgs& ... args
-)
-{
-    assert(1 + count <=
-        static_cast<size_t>((std::numeric_limits<int>::max)()));
+    tbb::task_group tasks;
 
-    rootTask.set_ref_count(1 + static_cast<int>(count));
-
-    for (size_t i=0; i < (count - 1); i++)
+    // Phase 1: Count the number of changed predecessors of every reachable node.
+    for (auto it = pulsecountRoots_.begin(); it != pulsecountRoots_.end(); )
     {
-        spawnList.push_back(*new(rootTask.allocate_child())
-            TTask(args ..., start, start + chunk_size));
-        start += chunk_size;
+        auto last = it + (std::min)(chunk_size, static_cast<size_t>(pulsecountRoots_.end() - it));
+        tasks.run(pulsecount::MarkerTask(*this, tasks, BufferT(it, last)));
+        it = last;
     }
 
-    spawnList.push_back(*new(rootTask.allocate_child())
-        TTask(args ..., start, end));
+    tasks.wait();
 
-    rootTask.spawn_and_wait_for_all(spawnList);
+    // Phase 2: Update nodes once all their predecessors are done.
+    // Attach/detach requests from dynamic nodes are buffered until the phase is over.
+    isInParallelPhase_ = true;
 
-    spawnList.clear();
-}
+    for (auto it = pulsecountRoots_.begin(); it != pulsecountRoots_.end(); )
+    {
+        auto last = it + (std::min)(chunk_size, static_cast<size_t>(pulsecountRoots_.end() - it));
+        tasks.run(pulsecount::UpdaterTask(*this, tasks, BufferT(it, last)));
+        it = last;
+    }
 
-void EngineBase::Propagate(Turn& turn)
-{
-    const size_t initialTaskCount = (changedInputs_.size() - 1) / chunk_size + 1;
+    tasks.wait();
 
-    spawnTasks<MarkerTask>(rootTask_, spawnList_, initialTaskCount,
-        changedInputs_.begin(), changedInputs_.end());
+    isInParallelPhase_ = false;
 
-    spawnTasks<UpdaterTask>(rootTask_, spawnList_, initialTaskCount,
-        changedInputs_.begin(), changedInputs_.end(), turn);
+    pulsecountRoots_.clear();
 
-    changedInputs_.clear();
-}
+    // Applies pending topology changes and schedules shifted nodes for the sequential fallback.
+    MergeParallelBuffers();
 
-void EngineBase::OnNodePulse(Node& node, Turn& turn)
-{
-    node.State = ENodeState::changed;
-}
+    bool hasShifted = ! scheduledNodes_.IsEmpty();
 
-void EngineBase::OnNodeIdlePulse(Node& node, Turn& turn)
-{
-    node.State = ENodeState::unchanged;
-}
+    for (ParallelBuffer& buffer : parallelBuffers_)
+    {
+        // Nodes that are still marked were stalled by a shifted predecessor.
+        // Reset them and let the fallback continue where the parallel phase stopped.
+        if (hasShifted)
+        {
+            for (NodeId nodeId : buffer.markedNodes)
+            {
+                NodeMark mark = nodeMarks_[nodeId].exchange(NodeMark::unmarked, std::memory_order_relaxed);
+                nodePendingCounts_[nodeId].store(0, std::memory_order_relaxed);
 
-void EngineBase::OnDynamicNodeAttach(Node& node, Node& parent, Turn& turn)
-{// parent.ShiftMutex (write)
-    NodeShiftMutexT::scoped_lock lock(parent.ShiftMutex, true);
-        
-    parent.Successors.Add(node);
+                if (mark == NodeMark::should_update && ! nodeQueued_[nodeId].exchange(true, std::memory_order_relaxed))
+                    scheduledNodes_.Push(nodeId, nodeLevels_[nodeId]);
+            }
+        }
 
-    // Has already nudged its neighbors?
-    if (parent.Mark() == ENodeMark::unmarked)
-    {
-        node.State = ENodeState::dyn_repeat;
-    }
-    else
-    {
-        node.State = ENodeState::dyn_defer;
-        node.IncCounter();
-        node.SetMark(ENodeMark::should_update);
+        buffer.markedNodes.clear();
     }
-}// ~parent.ShiftMutex (write)
 
-void EngineBase::OnDynamicNodeDetach(Node& node, Node& parent, Turn& turn)
-{// parent.ShiftMutex (write)
-    NodeShiftMutexT::scoped_lock lock(parent.ShiftMutex, true);
-
-    parent.Successors.Remove(node);
-}// ~parent.ShiftMutex (write)
+    if (hasShifted)
+        PropagateSequential();
+}
 
-} // ~namespace pulsecount
 /****************************************/ REACT_IMPL_END /***************************************/
-
-#endif
\ No newline at end of file
@@ -1,17 +1,18 @@
-
 //          Copyright Sebastian Jeckel 2017.
 // Distributed under the Boost Software License, Version 1.0.
 //    (See accompanying file LICENSE_1_0.txt or copy at
 //          http://www.boost.org/LICENSE_1_0.txt)
 
-#if 0
-
-#include "react/engine/SubtreeEngine.h"
+#include "react/detail/defs.h"
 
-#include <cstdint>
 #include <utility>
+#include <vector>
 
-#include "react/common/Types.h"
+#include <tbb/task_group.h>
+
+#include "react/common/nodebuffer.h"
+#include "react/detail/graph_interface.h"
+#include "react/detail/graph_impl.h"
 
 /***************************************/ REACT_IMPL_BEGIN /**************************************/
 namespace subtree {
@@ -19,330 +20,220 @@ namespace subtree {
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 /// Parameters
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-static const uint chunk_size    = 8;
-static const uint dfs_threshold = 3;
-
-///////////////////////////////////////////////////////////////////////////////////////////////////
-/// Turn
-///////////////////////////////////////////////////////////////////////////////////////////////////
-Turn::Turn(TurnIdT id, TransactionFlagsT flags) :
-    TurnBase( id, flags )
-{}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////
-/// PulsecountEngine
-///////////////////////////////////////////////////////////////////////////////////////////////////
-
-void EngineBase::AttachNode(Node& node, Node& parent)
-{
-    parent.Successors.Add(node);
-
-    if (node.Level <= parent.Level)
-        node.Level = parent.Level + 1;
-}
+static const size_t chunk_size      = 8;
+static const size_t dfs_threshold   = 3;
 
-void EngineBase::DetachNode(Node& node, Node& parent)
-{
-    parent.Successors.Remove(node);
-}
-
-void EngineBase::OnInputChange(Node& node, Turn& turn)
-{
-    processChildren(node, turn);
-}
+using BufferT = NodeBuffer<NodeId, chunk_size>;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 /// UpdaterTask
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-class UpdaterTask: public task
+class UpdaterTask
 {
 public:
-    using BufferT = NodeBuffer<Node,chunk_size>;
+    UpdaterTask(ReactGraph& graph, tbb::task_group& tasks, const BufferT& nodes) :
+        graph_( graph ),
+        tasks_( tasks ),
+        nodes_( nodes )
+    { }
 
-    UpdaterTask(Turn& turn, Node* node) :
-        turn_( turn ),
-        nodes_( node )
-    {}
+    void operator()() const
+    {
+        using NodeMark = ReactGraph::NodeMark;
 
-    UpdaterTask(UpdaterTask& other, SplitTag) :
-        turn_( other.turn_ ),
-        nodes_( other.nodes_, SplitTag( ) )
-    {}
+        BufferT nodes = nodes_;
+        ReactGraph::ParallelBuffer& buffer = graph_.parallelBuffers_.local();
 
-    task* execute()
-    {
-        uint splitCount = 0;
+        size_t splitCount = 0;
 
-        while (!nodes_.IsEmpty())
+        while (! nodes.IsEmpty())
         {
-            Node& node = splitCount > dfs_threshold ? *nodes_.PopBack() : *nodes_.PopFront();
+            NodeId nodeId = splitCount > dfs_threshold ? nodes.PopBack() : nodes.PopFront();
+            auto& node = graph_.nodeData_[nodeId];
 
-            if (node.IsInitial() || node.ShouldUpdate())
-                node.Tick(&turn_);
+            bool changed = false;
 
-            node.ClearInitialFlag();
-            node.SetShouldUpdate(false);
-
-            // Defer if node was dynamically attached to a predecessor that
-            // has not pulsed yet
-            if (node.IsDeferred())
+            if (graph_.nodeMarks_[nodeId].load(std::memory_order_relaxed) == NodeMark::should_update)
             {
-                node.ClearDeferredFlag();
-                continue;
-            }
+                if (graph_.ShouldPrune(nodeId))
+                {
+                    // Nothing depends on this node. Its successors are skipped as well.
+                    buffer.prunedNodes.push_back(nodeId);
+                }
+                else if (node.category == NodeCategory::linkoutput)
+                {
+                    // Link outputs write to a shared map, so they are collected after the phase.
+                    buffer.linkOutputNodes.push_back(nodeId);
+                }
+                else
+                {
+                    UpdateResult res = graph_.UpdateNode(nodeId);
 
-            // Repeat the update if a node was dynamically attached to a
-            // predecessor that has already pulsed
-            while (node.IsRepeated())
-            {
-                node.ClearRepeatedFlag();
-                node.Tick(&turn_);
+                    // Topology changed? Stop here. The successors of this node will stall and are
+                    // finished by the next sequential phase.
+                    if (res == UpdateResult::shifted)
+                    {
+                        graph_.nodeQueued_[nodeId] = true;
+                        buffer.shiftedNodes.push_back(nodeId);
+                        continue;
+                    }
+
+                    changed = res == UpdateResult::changed;
+                }
             }
 
-            node.SetReadyCount(0);
+            graph_.nodeMarks_[nodeId].store(NodeMark::unmarked, std::memory_order_relaxed);
 
-            // Mark successors for update?
-            bool update = node.IsChanged();
+            for (NodeId succId : graph_.nodeSuccessors_.Get(nodeId))
+            {
+                if (changed)
+                    graph_.nodeMarks_[succId].store(NodeMark::should_update, std::memory_order_relaxed);
 
-            {// node.ShiftMutex
-                Node::ShiftMutexT::scoped_lock lock(node.ShiftMutex, false);
+                // Wait for the remaining predecessors?
+                if (graph_.nodePendingCounts_[succId].fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    continue;
 
-                for (auto* succ : node.Successors)
+                // Heavyweight - spawn new task.
+                if (graph_.nodeData_[succId].isHeavy)
                 {
-                    if (update)
-                        succ->SetShouldUpdate(true);
-
-                    // Wait for more?
-                    if (succ->IncReadyCount())
-                        continue;
-
-                    // Heavyweight - spawn new task
-                    if (succ->IsHeavyweight())
-                    {
-                        auto& t = *new(task::allocate_additional_child_of(*parent()))
-                            UpdaterTask(turn_, succ);
+                    tasks_.run(UpdaterTask(graph_, tasks_, BufferT(succId)));
+                }
+                // Lightweight - add to buffer, split if full.
+                else
+                {
+                    nodes.PushBack(succId);
 
-                        spawn(t);
-                    }
-                    // Leightweight - add to buffer, split if full
-                    else
+                    if (nodes.IsFull())
                     {
-                        nodes_.PushBack(succ);
-
-                        if (nodes_.IsFull())
-                        {
-                            ++splitCount;
-
-                            //Delegate half the work to new task
-                            auto& t = *new(task::allocate_additional_child_of(*parent()))
-                                UpdaterTask(*this, SplitTag());
-
-                            spawn(t);
-                        }
+                        ++splitCount;
+                        tasks_.run(UpdaterTask(graph_, tasks_, BufferT(nodes, SplitTag{ })));
                     }
                 }
-
-                node.ClearMarkedFlag();
-            }// ~node.ShiftMutex
+            }
         }
-
-        return nullptr;
     }
 
 private:
-    Turn&   turn_;
-    BufferT nodes_;
+    ReactGraph&         graph_;
+    tbb::task_group&    tasks_;
+    BufferT             nodes_;
 };
 
+} // ~namespace subtree
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-/// EngineBase
+/// Subtree
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-void EngineBase::Propagate(Turn& turn)
+void ReactGraph::PropagateSubtree()
 {
-    // Phase 1
-    while (scheduledNodes_.FetchNext())
+    using subtree::BufferT;
+
+    for (;;)
     {
-        for (auto* curNode : scheduledNodes_.NextValues())
-        {
-            if (curNode->Level < curNode->NewLevel)
-            {
-                curNode->Level = curNode->NewLevel;
-                invalidateSuccessors(*curNode);
-                scheduledNodes_.Push(curNode);
-                continue;
-            }
+        // Phase 1: Sequential toposort of light nodes. Heavy successors of changed nodes are not
+        // scheduled, but their subtrees are marked for phase 2 instead.
+        PropagateSequential();
 
-            curNode->ClearQueuedFlag();
-            curNode->Tick(&turn);
-        }
-    }
+        if (subtreeRoots_.empty())
+            break;
 
-    // Phase 2
-    isInPhase2_ = true;
+        REACT_TRACE_SCOPE(traceSink_, "subtree_phase", subtreeRoots_.size());
 
-    assert((1 + subtreeRoots_.size()) <=
-        static_cast<size_t>((std::numeric_limits<int>::max)()));
+        // Phase 2: Update subtrees in parallel.
+        // Attach/detach requests from dynamic nodes are buffered until the phase is over.
+        tbb::task_group tasks;
 
-    rootTask_.set_ref_count(1 + static_cast<int>(subtreeRoots_.size()));
+        isInParallelPhase_ = true;
 
-    for (auto* node : subtreeRoots_)
-    {
-        // Ignore if root flag has been cleared because node was part of another subtree
-        if (! node->IsRoot())
+        for (NodeId nodeId : subtreeRoots_)
         {
-            rootTask_.decrement_ref_count();
-            continue;
-        }
+            // Ignore if node has become part of another subtree.
+            if (nodePendingCounts_[nodeId].load(std::memory_order_relaxed) != 0)
+                continue;
 
-        spawnList_.push_back(*new(rootTask_.allocate_child())
-            UpdaterTask(turn, node));
+            tasks.run(subtree::UpdaterTask(*this, tasks, BufferT(nodeId)));
+        }
 
-        node->ClearRootFlag();
-    }
+        tasks.wait();
 
-    rootTask_.spawn_and_wait_for_all(spawnList_);
+        isInParallelPhase_ = false;
 
-    subtreeRoots_.clear();
-    spawnList_.clear();
+        subtreeRoots_.clear();
 
-    isInPhase2_ = false;
-}
+        // Applies pending topology changes and schedules shifted nodes.
+        MergeParallelBuffers();
 
-void EngineBase::OnNodePulse(Node& node, Turn& turn)
-{
-    if (isInPhase2_)
-        node.SetChangedFlag();
-    else
-        processChildren(node, turn);
-}
-
-void EngineBase::OnNodeIdlePulse(Node& node, Turn& turn)
-{
-    if (isInPhase2_)
-        node.ClearChangedFlag();
-}
+        // Nodes that are still marked were stalled by a shifted predecessor.
+        // Reset them, so the next phase 1 can continue where phase 2 stopped.
+        for (NodeId nodeId : subtreeNodes_)
+        {
+            NodeMark mark = nodeMarks_[nodeId].exchange(NodeMark::unmarked, std::memory_order_relaxed);
+            nodePendingCounts_[nodeId].store(0, std::memory_order_relaxed);
 
-void EngineBase::OnDynamicNodeAttach(Node& node, Node& parent, Turn& turn)
-{
-    if (isInPhase2_)
-    {
-        applyAsyncDynamicAttach(node, parent, turn);
-    }
-    else
-    {
-        AttachNode(node, parent);
-    
-        invalidateSuccessors(node);
+            if (mark == NodeMark::should_update && ! nodeQueued_[nodeId].exchange(true, std::memory_order_relaxed))
+                scheduledNodes_.Push(nodeId, nodeLevels_[nodeId]);
+        }
 
-        // Re-schedule this node
-        node.SetQueuedFlag();
-        scheduledNodes_.Push(&node);
+        subtreeNodes_.clear();
     }
 }
 
-void EngineBase::OnDynamicNodeDetach(Node& node, Node& parent, Turn& turn)
-{
-    if (isInPhase2_)
-        applyAsyncDynamicDetach(node, parent, turn);
-    else
-        DetachNode(node, parent);
-}
-
-void EngineBase::applyAsyncDynamicAttach(Node& node, Node& parent, Turn& turn)
-{// parent.ShiftMutex (write)
-    NodeShiftMutexT::scoped_lock    lock(parent.ShiftMutex, true);
-        
-    parent.Successors.Add(node);
-
-    // Level recalulation applied when added to topoqueue next time.
-    // During the async phase 2 it's not needed.
-    if (node.NewLevel <= parent.Level)
-        node.NewLevel = parent.Level + 1;
-
-    // Has already nudged its neighbors?
-    if (! parent.IsMarked())
-    {
-        node.SetRepeatedFlag();
-    }
-    else
-    {
-        node.SetDeferredFlag();
-        node.SetShouldUpdate(true);
-        node.DecReadyCount();
-    }
-}// ~parent.ShiftMutex (write)
-
-void EngineBase::applyAsyncDynamicDetach(Node& node, Node& parent, Turn& turn)
-{// parent.ShiftMutex (write)
-    NodeShiftMutexT::scoped_lock    lock(parent.ShiftMutex, true);
-
-    parent.Successors.Remove(node);
-}// ~parent.ShiftMutex (write)
-
-void EngineBase::processChildren(Node& node, Turn& turn)
+void ReactGraph::ScheduleSubtreeSuccessors(NodeId nodeId)
 {
-    // Add children to queue
-    for (auto* succ : node.Successors)
+    for (NodeId succId : nodeSuccessors_.Get(nodeId))
     {
-        // Ignore if node part of marked subtree
-        if (succ->IsMarked())
+        // Part of a marked subtree? Phase 2 takes care of it.
+        if (nodeMarks_[succId].load(std::memory_order_relaxed) != NodeMark::unmarked)
+        {
+            nodeMarks_[succId].store(NodeMark::should_update, std::memory_order_relaxed);
             continue;
+        }
 
-        // Light nodes use sequential toposort in phase 1
-        if (! succ->IsHeavyweight())
+        // Light nodes use sequential toposort in phase 1.
+        if (! nodeData_[succId].isHeavy)
         {
-            if (!succ->IsQueued())
+            if (! nodeQueued_[succId])
             {
-                succ->SetQueuedFlag();
-                scheduledNodes_.Push(succ);
+                nodeQueued_[succId] = true;
+                scheduledNodes_.Push(succId, nodeLevels_[succId]);
             }
         }
-        // Heavy nodes + subtrees are deferred for parallel updating in phase 2
+        // Heavy nodes and their subtrees are deferred for parallel updating in phase 2.
         else
         {
-            // Force an initial update for heavy non-input nodes.
-            // (non-atomic flag, unlike ShouldUpdate)
-            if (!succ->IsInputNode())
-                succ->SetInitialFlag();
-
-            succ->SetChangedFlag();
-            succ->SetRootFlag();
-
-            markSubtree(*succ);
-
-            subtreeRoots_.push_back(succ);
+            MarkSubtree(succId);
+            nodeMarks_[succId].store(NodeMark::should_update, std::memory_order_relaxed);
+            subtreeRoots_.push_back(succId);
         }
     }
 }
 
-void EngineBase::markSubtree(Node& root)
+void ReactGraph::MarkSubtree(NodeId rootId)
 {
-    root.SetMarkedFlag();
-    root.WaitCount = 0;
+    // Iterative DFS. Every edge inside the marked region is counted exactly once.
+    // The search stack is empty between uses, so it can be shared with the other searches.
+    nodeMarks_[rootId].store(NodeMark::visited, std::memory_order_relaxed);
+    subtreeNodes_.push_back(rootId);
+    searchStack_.push_back(rootId);
 
-    for (auto* succ : root.Successors)
+    while (! searchStack_.empty())
     {
-        if (!succ->IsMarked())
-            markSubtree(*succ);
+        NodeId nodeId = searchStack_.back();
+        searchStack_.pop_back();
 
-        // Successor of another marked node? -> not a root anymore
-        else if (succ->IsRoot())
-            succ->ClearRootFlag();
+        for (NodeId succId : nodeSuccessors_.Get(nodeId))
+        {
+            // If succ is the root of another subtree, this makes it an inner node of this one.
+            nodePendingCounts_[succId].fetch_add(1, std::memory_order_relaxed);
 
-        ++succ->WaitCount;
-    }
-}
+            if (nodeMarks_[succId].load(std::memory_order_relaxed) != NodeMark::unmarked)
+                continue;
 
-void EngineBase::invalidateSuccessors(Node& node)
-{
-    for (auto* succ : node.Successors)
-    {
-        if (succ->NewLevel <= node.Level)
-            succ->NewLevel = node.Level + 1;
+            nodeMarks_[succId].store(NodeMark::visited, std::memory_order_relaxed);
+            subtreeNodes_.push_back(succId);
+            searchStack_.push_back(succId);
+        }
     }
 }
 
-} // ~namespace subtree
 /****************************************/ REACT_IMPL_END /***************************************/
-
-#endif
\ No newline at end of file
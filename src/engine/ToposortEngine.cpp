@@ -1,223 +1,156 @@
-
 //          Copyright Sebastian Jeckel 2017.
 // Distributed under the Boost Software License, Version 1.0.
 //    (See accompanying file LICENSE_1_0.txt or copy at
 //          http://www.boost.org/LICENSE_1_0.txt)
 
-#if 0
+#include "react/detail/defs.h"
 
-#include "react/engine/ToposortEngine.h"
-#include "tbb/parallel_for.h"
+#include <utility>
+#include <vector>
 
-/***************************************/ REACT_IMPL_BEGIN /**************************************/
-namespace toposort {
+#include <tbb/task_group.h>
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-/// SeqTurn
-///////////////////////////////////////////////////////////////////////////////////////////////////
-SeqTurn::SeqTurn(TurnIdT id, TransactionFlagsT flags) :
-    TurnBase( id, flags )
-{}
+#include "react/detail/graph_interface.h"
+#include "react/detail/graph_impl.h"
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-/// ParTurn
-///////////////////////////////////////////////////////////////////////////////////////////////////
-ParTurn::ParTurn(TurnIdT id, TransactionFlagsT flags) :
-    TurnBase( id, flags )
-{}
+/***************************************/ REACT_IMPL_BEGIN /**************************************/
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-/// EngineBase
+/// Level-parallel toposort
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-template <typename TNode, typename TTurn>
-void EngineBase<TNode,TTurn>::AttachNode(TNode& node, TNode& parent)
+void ReactGraph::PropagateLevelParallel()
 {
-    parent.Successors.Add(node);
+    auto updateNode = [this] (NodeId nodeId, int level)
+        {
+            ParallelBuffer& buffer = parallelBuffers_.local();
 
-    if (node.Level <= parent.Level)
-        node.Level = parent.Level + 1;
-}
+            // Node has been moved to a higher level after it was scheduled?
+            if (nodeLevels_[nodeId] != level)
+            {
+                buffer.scheduledNodes.push_back(nodeId);
+                return;
+            }
 
-template <typename TNode, typename TTurn>
-void EngineBase<TNode,TTurn>::DetachNode(TNode& node, TNode& parent)
-{
-    parent.Successors.Remove(node);
-}
+            // Nothing depends on this node? It's marked as stale after the level.
+            if (ShouldPrune(nodeId))
+            {
+                buffer.prunedNodes.push_back(nodeId);
+                nodeQueued_[nodeId].store(false, std::memory_order_relaxed);
+                return;
+            }
 
-template <typename TNode, typename TTurn>
-void EngineBase<TNode,TTurn>::OnInputChange(TNode& node, TTurn& turn)
-{
-    processChildren(node, turn);
-}
+            // Link outputs write to a shared map, so they are collected after the level.
+            if (nodeData_[nodeId].category == NodeCategory::linkoutput)
+            {
+                buffer.linkOutputNodes.push_back(nodeId);
+                return;
+            }
 
-template <typename TNode, typename TTurn>
-void EngineBase<TNode,TTurn>::OnNodePulse(TNode& node, TTurn& turn)
-{
-    processChildren(node, turn);
-}
+            UpdateResult res = UpdateNode(nodeId);
 
-// Explicit instantiation
-template class EngineBase<SeqNode,SeqTurn>;
-template class EngineBase<ParNode,ParTurn>;
+            // Topology changed? The attach/detach requests are still pending at this point.
+            if (res == UpdateResult::shifted)
+            {
+                buffer.shiftedNodes.push_back(nodeId);
+                return;
+            }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-/// SeqEngineBase
-///////////////////////////////////////////////////////////////////////////////////////////////////
-void SeqEngineBase::Propagate(SeqTurn& turn)
-{
-    while (scheduledNodes_.FetchNext())
-    {
-        for (auto* curNode : scheduledNodes_.NextValues())
-        {
-            if (curNode->Level < curNode->NewLevel)
+            if (res == UpdateResult::changed)
             {
-                curNode->Level = curNode->NewLevel;
-                invalidateSuccessors(*curNode);
-                scheduledNodes_.Push(curNode);
-                continue;
+                for (NodeId succId : nodeSuccessors_.Get(nodeId))
+                    if (! nodeQueued_[succId].exchange(true, std::memory_order_relaxed))
+                        buffer.scheduledNodes.push_back(succId);
             }
 
-            curNode->Queued = false;
-            curNode->Tick(&turn);
-        }
-    }
-}
+            nodeQueued_[nodeId].store(false, std::memory_order_relaxed);
+        };
 
-void SeqEngineBase::OnDynamicNodeAttach(SeqNode& node, SeqNode& parent, SeqTurn& turn)
-{
-    this->AttachNode(node, parent);
-    
-    invalidateSuccessors(node);
+    while (scheduledNodes_.FetchNext())
+    {
+        const std::vector<NodeId>& next = scheduledNodes_.Next();
+        int level = scheduledNodes_.NextLevel();
 
-    // Re-schedule this node
-    node.Queued = true;
-    scheduledNodes_.Push(&node);
-}
+        REACT_TRACE_SCOPE(traceSink_, "level", level);
 
-void SeqEngineBase::OnDynamicNodeDetach(SeqNode& node, SeqNode& parent, SeqTurn& turn)
-{
-    this->DetachNode(node, parent);
-}
+        // Nodes of the same level don't depend on each other, so they can be updated in parallel.
+        // Everything that touches shared state (queue, topology, link outputs) is buffered per thread
+        // and merged sequentially once the level is done.
+        isInParallelPhase_ = true;
 
-void SeqEngineBase::processChildren(SeqNode& node, SeqTurn& turn)
-{
-    // Add children to queue
-    for (auto* succ : node.Successors)
-    {
-        if (!succ->Queued)
+        // Heavy nodes are dispatched to worker threads. Light nodes are updated inline, since
+        // spawning a task would cost more than the update itself.
+        tbb::task_group tasks;
+
+        for (NodeId nodeId : next)
         {
-            succ->Queued = true;
-            scheduledNodes_.Push(succ);
+            if (nodeData_[nodeId].isHeavy)
+                tasks.run([&updateNode, nodeId, level] { updateNode(nodeId, level); });
+            else
+                lightNodes_.push_back(nodeId);
         }
+
+        for (NodeId nodeId : lightNodes_)
+            updateNode(nodeId, level);
+
+        tasks.wait();
+
+        lightNodes_.clear();
+
+        isInParallelPhase_ = false;
+
+        MergeParallelBuffers();
     }
 }
 
-void SeqEngineBase::invalidateSuccessors(SeqNode& node)
+void ReactGraph::MergeParallelBuffers()
 {
-    for (auto* succ : node.Successors)
+    // Mark pruned nodes before the topology changes. An attach can make them observed again,
+    // which refreshes everything that is stale.
+    for (ParallelBuffer& buffer : parallelBuffers_)
     {
-        if (succ->NewLevel <= node.Level)
-            succ->NewLevel = node.Level + 1;
+        for (NodeId nodeId : buffer.prunedNodes)
+            MarkStale(nodeId);
+        buffer.prunedNodes.clear();
     }
-}
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-/// ParEngineBase
-///////////////////////////////////////////////////////////////////////////////////////////////////
-void ParEngineBase::Propagate(ParTurn& turn)
-{
-    while (topoQueue_.FetchNext())
+    // Apply topology changes first, so levels are up-to-date when nodes are re-scheduled.
+    for (ParallelBuffer& buffer : parallelBuffers_)
     {
-        //using RangeT = tbb::blocked_range<vector<ParNode*>::const_iterator>;
-        using RangeT = ParEngineBase::TopoQueueT::NextRangeT;
-
-        // Iterate all nodes of current level and start processing them in parallel
-        tbb::parallel_for(
-            topoQueue_.NextRange(),
-            [&] (const RangeT& range)
-            {
-                for (const auto& e : range)
-                {
-                    auto* curNode = e.first;
-
-                    if (curNode->Level < curNode->NewLevel)
-                    {
-                        curNode->Level = curNode->NewLevel;
-                        invalidateSuccessors(*curNode);
-                        topoQueue_.Push(curNode);
-                        continue;
-                    }
-
-                    curNode->Collected = false;
-
-                    // Tick -> if changed: OnNodePulse -> adds child nodes to the queue
-                    curNode->Tick(&turn);
-                }
-            }
-        );
-
-        if (dynRequests_.size() > 0)
+        for (const TopologyRequest& req : buffer.topologyRequests)
         {
-            for (auto req : dynRequests_)
-            {
-                if (req.ShouldAttach)
-                    applyDynamicAttach(*req.Node, *req.Parent, turn);
-                else
-                    applyDynamicDetach(*req.Node, *req.Parent, turn);
-            }
-            dynRequests_.clear();
+            if (req.isAttach)
+                AttachNode(req.nodeId, req.parentId);
+            else
+                DetachNode(req.nodeId, req.parentId);
         }
-    }
-}
 
-void ParEngineBase::OnDynamicNodeAttach(ParNode& node, ParNode& parent, ParTurn& turn)
-{
-    DynRequestData data{ true, &node, &parent };
-    dynRequests_.push_back(data);
-}
-
-void ParEngineBase::OnDynamicNodeDetach(ParNode& node, ParNode& parent, ParTurn& turn)
-{
-    DynRequestData data{ false, &node, &parent };
-    dynRequests_.push_back(data);
-}
-
-void ParEngineBase::applyDynamicAttach(ParNode& node, ParNode& parent, ParTurn& turn)
-{
-    this->AttachNode(node, parent);
-
-    invalidateSuccessors(node);
+        buffer.topologyRequests.clear();
+    }
 
-    // Re-schedule this node
-    node.Collected = true;
-    topoQueue_.Push(&node);
-}
+    for (ParallelBuffer& buffer : parallelBuffers_)
+    {
+        for (NodeId nodeId : buffer.scheduledNodes)
+            scheduledNodes_.Push(nodeId, nodeLevels_[nodeId]);
+        buffer.scheduledNodes.clear();
 
-void ParEngineBase::applyDynamicDetach(ParNode& node, ParNode& parent, ParTurn& turn)
-{
-    this->DetachNode(node, parent);
-}
+        for (NodeId nodeId : buffer.linkOutputNodes)
+        {
+            nodeData_[nodeId].nodePtr->CollectOutput(scheduledLinkOutputs_);
+            nodeQueued_[nodeId].store(false, std::memory_order_relaxed);
+        }
+        buffer.linkOutputNodes.clear();
 
-void ParEngineBase::processChildren(ParNode& node, ParTurn& turn)
-{
-    // Add children to queue
-    for (auto* succ : node.Successors)
-        if (!succ->Collected.exchange(true, std::memory_order_relaxed))
-            topoQueue_.Push(succ);
+        for (NodeId nodeId : buffer.shiftedNodes)
+            ApplyShift(nodeId);
+        buffer.shiftedNodes.clear();
+    }
 }
 
-void ParEngineBase::invalidateSuccessors(ParNode& node)
+void ReactGraph::ApplyShift(NodeId nodeId)
 {
-    for (auto* succ : node.Successors)
-    {// succ->InvalidateMutex
-        ParNode::InvalidateMutexT::scoped_lock lock(succ->InvalidateMutex);
-
-        if (succ->NewLevel <= node.Level)
-            succ->NewLevel = node.Level + 1;
-    }// ~succ->InvalidateMutex
+    // Re-schedule this node. Its level and the levels of its successors have already been
+    // updated when the topology requests were applied.
+    scheduledNodes_.Push(nodeId, nodeLevels_[nodeId]);
 }
 
-} // ~namespace toposort
 /****************************************/ REACT_IMPL_END /***************************************/
-
-#endif
\ No newline at end of file
@@ -6,10 +6,15 @@
 
 #include "gtest/gtest.h"
 
+#include "react/common/histogram.h"
+#include "react/common/ringqueue.h"
+#include "react/common/smallfunction.h"
 #include "react/common/syncpoint.h"
 
+#include <array>
 #include <chrono>
 #include <cstdio>
+#include <memory>
 #include <thread>
 
 using namespace react;
@@ -158,4 +163,205 @@ TEST(SyncPointTest, MultiWaitFor)
     t1.join();
     t2.join();
     t3.join();
-}
\ No newline at end of file
+}
+
+TEST(SyncPointTest, FanIn)
+{
+    SyncPoint sp1;
+    SyncPoint sp2;
+
+    // Nested collections target both sync points.
+    std::vector<SyncPoint::Dependency> inner = { SyncPoint::Dependency(sp1), SyncPoint::Dependency(sp2) };
+    std::vector<SyncPoint::Dependency> outer = { SyncPoint::Dependency(inner.begin(), inner.end()), SyncPoint::Dependency(sp1) };
+
+    SyncPoint::Dependency merged(outer.begin(), outer.end());
+
+    inner.clear();
+    outer.clear();
+
+    EXPECT_FALSE(sp1.WaitFor(std::chrono::milliseconds(1)));
+    EXPECT_FALSE(sp2.WaitFor(std::chrono::milliseconds(1)));
+
+    // Many threads split and release the same dependency concurrently.
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([dep = merged]
+            {
+                for (int i = 0; i < 10000; ++i)
+                {
+                    SyncPoint::Dependency copy = dep;
+                    SyncPoint::Dependency moved = std::move(copy);
+                }
+            });
+    }
+
+    merged.Release();
+
+    sp1.Wait();
+    sp2.Wait();
+
+    for (auto& t : threads)
+        t.join();
+
+    EXPECT_TRUE(sp1.WaitFor(std::chrono::milliseconds(1)));
+    EXPECT_TRUE(merged.IsReleased());
+}
+
+TEST(SyncPointTest, MergeDuplicates)
+{
+    SyncPoint sp1;
+    SyncPoint sp2;
+
+    // Merging the same sync point several times collapses to a single dependency.
+    {
+        std::vector<SyncPoint::Dependency> deps = { SyncPoint::Dependency(sp1), SyncPoint::Dependency(sp1), SyncPoint::Dependency() };
+        SyncPoint::Dependency merged(deps.begin(), deps.end());
+
+        deps.clear();
+
+        EXPECT_FALSE(merged.IsReleased());
+        EXPECT_FALSE(sp1.WaitFor(std::chrono::milliseconds(1)));
+
+        merged.Release();
+        EXPECT_TRUE(sp1.WaitFor(std::chrono::milliseconds(1)));
+    }
+
+    // Only released dependencies merge to an unbound one.
+    {
+        std::vector<SyncPoint::Dependency> deps(3);
+        SyncPoint::Dependency merged(deps.begin(), deps.end());
+
+        EXPECT_TRUE(merged.IsReleased());
+    }
+
+    // Collections are recycled, so repeated merging must not leave stale targets behind.
+    for (int i = 0; i < 100; ++i)
+    {
+        std::vector<SyncPoint::Dependency> deps = { SyncPoint::Dependency(sp1), SyncPoint::Dependency(sp2), SyncPoint::Dependency(sp1) };
+        SyncPoint::Dependency merged(deps.begin(), deps.end());
+        SyncPoint::Dependency copy;
+
+        if (i % 2 == 0)
+            copy = merged;
+
+        deps.clear();
+        merged.Release();
+
+        EXPECT_EQ(i % 2 != 0, sp1.WaitFor(std::chrono::milliseconds(0)));
+        EXPECT_EQ(i % 2 != 0, sp2.WaitFor(std::chrono::milliseconds(0)));
+    }
+
+    EXPECT_TRUE(sp1.WaitFor(std::chrono::milliseconds(1)));
+    EXPECT_TRUE(sp2.WaitFor(std::chrono::milliseconds(1)));
+}
+
+TEST(SyncPointTest, CrossThreadRecycling)
+{
+    SyncPoint sp1;
+    SyncPoint sp2;
+
+    // Merged on this thread and released on another one, like the dependencies of a link.
+    auto mergeAndRelease = [&]
+        {
+            std::vector<SyncPoint::Dependency> deps = { SyncPoint::Dependency(sp1), SyncPoint::Dependency(sp2) };
+            SyncPoint::Dependency merged(deps.begin(), deps.end());
+            deps.clear();
+
+            std::thread releaser([dep = std::move(merged)] () mutable { dep.Release(); });
+            releaser.join();
+        };
+
+    // Warm up the pool.
+    mergeAndRelease();
+
+    size_t allocationCount = SyncPoint::GetCollectionAllocationCount();
+
+    for (int i = 0; i < 100; ++i)
+        mergeAndRelease();
+
+    EXPECT_EQ(allocationCount, SyncPoint::GetCollectionAllocationCount());
+
+    EXPECT_TRUE(sp1.WaitFor(std::chrono::milliseconds(1)));
+    EXPECT_TRUE(sp2.WaitFor(std::chrono::milliseconds(1)));
+}
+
+TEST(HistogramTest, Percentiles)
+{
+    Histogram h;
+
+    for (uint64_t v = 1; v <= 1000; ++v)
+        h.Record(v);
+
+    HistogramSnapshot s = h.Snapshot();
+
+    EXPECT_EQ(1000u, s.count);
+    EXPECT_EQ(1u, s.min);
+    EXPECT_EQ(1000u, s.max);
+    EXPECT_DOUBLE_EQ(500.5, s.Mean());
+
+    // Relative error is bounded by the bucket width.
+    EXPECT_NEAR(500.0, static_cast<double>(s.Percentile(50)), 500.0 / 8);
+    EXPECT_NEAR(990.0, static_cast<double>(s.Percentile(99)), 990.0 / 8);
+    EXPECT_EQ(1000u, s.Percentile(100));
+
+    // Small values are exact.
+    h.Reset();
+    h.Record(0);
+    h.Record(3);
+    h.Record(3);
+
+    s = h.Snapshot();
+    EXPECT_EQ(3u, s.count);
+    EXPECT_EQ(0u, s.min);
+    EXPECT_EQ(3u, s.Percentile(50));
+
+    // Large values don't overflow.
+    h.Record((std::numeric_limits<uint64_t>::max)());
+    EXPECT_EQ((std::numeric_limits<uint64_t>::max)(), h.Snapshot().max);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(RingQueueTest, SmallFunctions)
+{
+    using FuncType = REACT_IMPL::SmallFunction<32>;
+
+    REACT_IMPL::RingQueue<FuncType> queue(3);
+    EXPECT_EQ(4u, queue.Capacity());
+
+    int sum = 0;
+    auto counter = std::make_shared<int>(0);
+
+    for (int i = 1; i <= 4; ++i)
+        EXPECT_TRUE(queue.TryPush(FuncType([&sum, i] { sum += i; })));
+
+    // Full. The rejected callable is not moved from.
+    FuncType rejected([counter] { ++*counter; });
+    EXPECT_FALSE(queue.TryPush(std::move(rejected)));
+    EXPECT_TRUE(static_cast<bool>(rejected));
+
+    FuncType func;
+
+    while (queue.TryPop(func))
+        func();
+
+    EXPECT_EQ(10, sum);
+
+    // Captures that don't fit are stored on the heap.
+    std::array<int, 16> large = { };
+    large[15] = 5;
+
+    EXPECT_TRUE(queue.TryPush(std::move(rejected)));
+    EXPECT_TRUE(queue.TryPush(FuncType([&sum, large] { sum += large[15]; })));
+
+    while (queue.TryPop(func))
+        func();
+
+    EXPECT_EQ(15, sum);
+    EXPECT_EQ(1, *counter);
+
+    // Destroyed captures are released.
+    func.Reset();
+    EXPECT_EQ(1, counter.use_count());
+}
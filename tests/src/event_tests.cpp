@@ -12,10 +12,12 @@
 
 #include <algorithm>
 #include <chrono>
+#include <memory>
 #include <queue>
 #include <string>
 #include <thread>
 #include <tuple>
+#include <vector>
 
 using namespace react;
 
@@ -220,6 +222,57 @@ TEST(EventTest, Links)
     EXPECT_EQ(3, turns);
 }
 
+TEST(EventTest, SharedLinks)
+{
+    Group g1;
+    Group g2;
+    Group g3;
+
+    auto src = EventSource<int>::Create(g1);
+
+    // Both links receive the same buffer.
+    auto lnk2 = EventLink<int>::Create(g2, src);
+    auto lnk3 = EventLink<int>::Create(g3, src);
+
+    std::vector<int> output1;
+    std::vector<int> output2;
+    std::vector<int> output3;
+
+    auto obs1 = Observer::Create([&] (const auto& events)
+        {
+            output1.insert(output1.end(), events.begin(), events.end());
+        }, src);
+
+    auto obs2 = Observer::Create([&] (const auto& events)
+        {
+            output2.insert(output2.end(), events.begin(), events.end());
+        }, lnk2);
+
+    auto obs3 = Observer::Create([&] (const auto& events)
+        {
+            output3.insert(output3.end(), events.begin(), events.end());
+        }, lnk3);
+
+    g1.DoTransaction([&]
+        {
+            src << 1 << 2 << 3;
+        });
+
+    g1.DoTransaction([&]
+        {
+            src << 4;
+        });
+
+    g2.WaitIdle();
+    g3.WaitIdle();
+
+    std::vector<int> expected = { 1, 2, 3, 4 };
+
+    EXPECT_EQ(expected, output1);
+    EXPECT_EQ(expected, output2);
+    EXPECT_EQ(expected, output3);
+}
+
 TEST(EventTest, EventSources)
 {
     Group g;
@@ -383,6 +436,71 @@ TEST(EventTest, Merge3)
     EXPECT_TRUE(results.empty());
 }
 
+TEST(EventTest, MergeAcrossTurns)
+{
+    Group g;
+
+    auto a1 = EventSource<int>::Create(g);
+    auto a2 = EventSource<int>::Create(g);
+
+    Event<int> merged = Merge(g, a1, a2);
+
+    std::vector<int> results;
+
+    auto obs1 = Observer::Create([&] (const auto& events)
+        {
+            for (int e : events)
+                results.push_back(e);
+        }, merged);
+
+    a1.Emit(10);
+    a2.Emit(20);
+    a2.Emit(30);
+
+    // Events of a previous turn must not show up again.
+    ASSERT_EQ(3u, results.size());
+    EXPECT_EQ(results[0], 10);
+    EXPECT_EQ(results[1], 20);
+    EXPECT_EQ(results[2], 30);
+}
+
+TEST(EventTest, ObserveDuringTransaction)
+{
+    Group g;
+    g.SetPruningEnabled(true);
+
+    auto a1 = EventSource<int>::Create(g);
+    auto a2 = EventSource<int>::Create(g);
+
+    Event<int> merged = Merge(g, a1, a2);
+
+    // Nothing observes merged, so it becomes stale.
+    a1.Emit(1);
+
+    std::vector<int> results;
+    std::unique_ptr<Observer> obs;
+
+    g.DoTransaction([&]
+        {
+            a1.Emit(2);
+
+            // Refreshing merged must not add the events of this turn twice.
+            obs = std::make_unique<Observer>(Observer::Create([&] (const auto& events)
+                {
+                    for (int e : events)
+                        results.push_back(e);
+                }, merged));
+        });
+
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ(2, results[0]);
+
+    a2.Emit(3);
+
+    ASSERT_EQ(2u, results.size());
+    EXPECT_EQ(3, results[1]);
+}
+
 TEST(EventTest, Filter)
 {
     Group g;
@@ -0,0 +1,420 @@
+//          Copyright Sebastian Jeckel 2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "gtest/gtest.h"
+
+#include "react/algorithm.h"
+#include "react/state.h"
+#include "react/observer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace react;
+
+static void TestWideGraph(PropagationMode mode)
+{
+    Group g;
+    g.SetPropagationMode(mode);
+
+    const int width = 100;
+
+    auto in = StateVar<int>::Create(g, 0);
+
+    std::vector<State<int>> nodes;
+    std::vector<Observer>   observers;
+    std::vector<int>        outputs(width, 0);
+
+    for (int i = 0; i < width; ++i)
+    {
+        nodes.push_back(State<int>::Create([i] (int v) { return v + i; }, in));
+
+        // Second level reads two first level nodes. Updates must never see one of them stale.
+        auto sum = State<int>::Create([] (int a, int b) { return a + b; }, nodes[i], nodes[i / 2]);
+
+        // Heavy nodes on both levels create overlapping subtrees.
+        if (i % 10 == 0)
+            nodes[i].SetWeightHint(WeightHint::heavy);
+        if (i % 7 == 0)
+            sum.SetWeightHint(WeightHint::heavy);
+
+        observers.push_back(Observer::Create([&outputs, i] (int v) { outputs[i] = v; }, sum));
+    }
+
+    for (int v = 1; v <= 10; ++v)
+    {
+        in.Set(v);
+
+        for (int i = 0; i < width; ++i)
+            EXPECT_EQ(2 * v + i + i / 2, outputs[i]);
+    }
+}
+
+static void TestDynamicGraph(PropagationMode mode)
+{
+    Group g;
+    g.SetPropagationMode(mode);
+
+    auto a = StateVar<int>::Create(g, 1);
+    auto b = StateVar<int>::Create(g, 10);
+
+    // b2 has a higher level than a, so switching the inner node shifts the flattened node.
+    auto b2 = State<int>::Create([] (int v) { return v * 2; }, b);
+
+    auto outer = StateVar<State<int>>::Create(g, a);
+    auto flat = Flatten(outer);
+
+    // Shifts inside of a parallel subtree.
+    flat.SetWeightHint(WeightHint::heavy);
+
+    auto result = State<int>::Create([] (int v, int w) { return v + w; }, flat, b);
+
+    int output = 0;
+    int turns = 0;
+
+    auto obs = Observer::Create([&] (int v)
+        {
+            ++turns;
+            output = v;
+        }, result);
+
+    EXPECT_EQ(11, output);
+    EXPECT_EQ(1, turns);
+
+    outer.Set(b2);
+    EXPECT_EQ(30, output);
+    EXPECT_EQ(2, turns);
+
+    b.Set(20);
+    EXPECT_EQ(60, output);
+    EXPECT_EQ(3, turns);
+
+    a.Set(5);
+    EXPECT_EQ(60, output);
+    EXPECT_EQ(3, turns);
+
+    outer.Set(a);
+    EXPECT_EQ(25, output);
+    EXPECT_EQ(4, turns);
+}
+
+TEST(PropagationTest, NodeChurn)
+{
+    Group g;
+
+    auto in = StateVar<int>::Create(g, 0);
+
+    int sum = 0;
+
+    // Creates and destroys successors of the same node repeatedly, so their storage is
+    // moved and compacted several times.
+    for (int round = 1; round <= 20; ++round)
+    {
+        std::vector<State<int>> nodes;
+        std::vector<Observer>   observers;
+
+        for (int i = 0; i < round * 5; ++i)
+        {
+            nodes.push_back(State<int>::Create([i] (int v) { return v + i; }, in));
+            observers.push_back(Observer::Create([&sum] (int v) { sum += v; }, nodes.back()));
+        }
+
+        sum = 0;
+        in.Set(round);
+
+        int expected = 0;
+        for (int i = 0; i < round * 5; ++i)
+            expected += round + i;
+
+        EXPECT_EQ(expected, sum);
+    }
+}
+
+TEST(PropagationTest, DeepRewiring)
+{
+    Group g;
+
+    auto a = StateVar<int>::Create(g, 1);
+    auto b = StateVar<int>::Create(g, 100);
+
+    // Deep chain below a.
+    std::vector<State<int>> deep{ State<int>::Create([] (int v) { return v; }, a) };
+    for (int i = 0; i < 50; ++i)
+        deep.push_back(State<int>::Create([] (int v) { return v; }, deep.back()));
+
+    auto outer = StateVar<State<int>>::Create(g, b);
+    auto flat = Flatten(outer);
+
+    // Chain below the flattened node. It has to move as a whole, once flat is re-attached below deep.
+    std::vector<State<int>> chain{ State<int>::Create([] (int v) { return v; }, flat) };
+    for (int i = 0; i < 20; ++i)
+        chain.push_back(State<int>::Create([] (int v) { return v; }, chain.back()));
+
+    auto result = State<int>::Create([] (int v, int w) { return v + w; }, chain.back(), deep.back());
+
+    std::vector<int> outputs;
+
+    auto obs = Observer::Create([&] (int v) { outputs.push_back(v); }, result);
+
+    outputs.clear();
+
+    outer.Set(deep.back());
+    ASSERT_EQ(1u, outputs.size());
+    EXPECT_EQ(2, outputs.back());
+
+    // Both inputs of result change. It must only be updated once, after both have been updated.
+    a.Set(5);
+    ASSERT_EQ(2u, outputs.size());
+    EXPECT_EQ(10, outputs.back());
+
+    outer.Set(b);
+    ASSERT_EQ(3u, outputs.size());
+    EXPECT_EQ(105, outputs.back());
+}
+
+TEST(PropagationTest, Pruning)
+{
+    Group g;
+    g.SetPruningEnabled(true);
+
+    auto in = StateVar<int>::Create(g, 1);
+
+    int updates = 0;
+
+    auto a = State<int>::Create([&] (int v) { ++updates; return v * 2; }, in);
+    auto b = State<int>::Create([&] (int v) { ++updates; return v + 1; }, a);
+
+    updates = 0;
+
+    // Nothing observes a or b, so they are skipped.
+    in.Set(2);
+    in.Set(3);
+    EXPECT_EQ(0, updates);
+
+    // Attaching an observer brings them up-to-date first.
+    int output = 0;
+    auto obs = std::make_unique<Observer>(Observer::Create([&] (int v) { output = v; }, b));
+    EXPECT_EQ(2, updates);
+    EXPECT_EQ(7, output);
+
+    in.Set(4);
+    EXPECT_EQ(4, updates);
+    EXPECT_EQ(9, output);
+
+    // Unobserved again.
+    obs.reset();
+    in.Set(5);
+    EXPECT_EQ(4, updates);
+
+    // Switching a flattened node to the stale node refreshes it during the turn.
+    auto other = StateVar<int>::Create(g, 0);
+    auto outer = StateVar<State<int>>::Create(g, other);
+    auto flat = Flatten(outer);
+
+    auto obs2 = Observer::Create([&] (int v) { output = v; }, flat);
+    EXPECT_EQ(0, output);
+
+    outer.Set(b);
+    EXPECT_EQ(6, updates);
+    EXPECT_EQ(11, output);
+
+    // Disabling pruning refreshes everything that is stale.
+    auto c = State<int>::Create([&] (int v) { ++updates; return v - 1; }, in);
+    EXPECT_EQ(7, updates);
+
+    in.Set(6);
+    EXPECT_EQ(9, updates);
+
+    g.SetPruningEnabled(false);
+    EXPECT_EQ(10, updates);
+
+    in.Set(7);
+    EXPECT_EQ(13, updates);
+}
+
+static void TestAutomaticWeights(PropagationMode mode)
+{
+    Group g;
+    g.SetPropagationMode(mode);
+
+    const int width = 8;
+
+    auto in = StateVar<int>::Create(g, 0);
+
+    std::vector<State<int>> nodes;
+    std::vector<int>        outputs(width, 0);
+
+    // Slow nodes become heavy once their updates have been measured. Fast ones stay light.
+    for (int i = 0; i < width; ++i)
+    {
+        nodes.push_back(State<int>::Create([i] (int v)
+            {
+                if (i % 2 == 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                return v + i;
+            }, in));
+    }
+
+    auto sum = State<int>::Create([] (int a, int b, int c, int d) { return a + b + c + d; },
+        nodes[0], nodes[1], nodes[2], nodes[3]);
+
+    int sumOutput = 0;
+
+    std::vector<Observer> observers;
+
+    for (int i = 0; i < width; ++i)
+        observers.push_back(Observer::Create([&outputs, i] (int v) { outputs[i] = v; }, nodes[i]));
+
+    observers.push_back(Observer::Create([&] (int v) { sumOutput = v; }, sum));
+
+    for (int v = 1; v <= 20; ++v)
+    {
+        in.Set(v);
+
+        for (int i = 0; i < width; ++i)
+            EXPECT_EQ(v + i, outputs[i]);
+
+        EXPECT_EQ(4 * v + 6, sumOutput);
+    }
+
+    // Measured weights depend on timing, so only the deterministic parts are checked.
+    // Sequential propagation doesn't sample, so automatic nodes stay light however slow they are.
+    if (mode == PropagationMode::sequential)
+    {
+        for (int i = 0; i < width; ++i)
+            EXPECT_FALSE(nodes[i].IsHeavy());
+    }
+
+    // Hints are honoured in every mode, and hinted nodes aren't measured.
+    nodes[0].SetWeightHint(WeightHint::light);
+    nodes[1].SetWeightHint(WeightHint::heavy);
+
+    for (int v = 21; v <= 40; ++v)
+    {
+        in.Set(v);
+
+        EXPECT_EQ(v, outputs[0]);
+        EXPECT_EQ(v + 1, outputs[1]);
+        EXPECT_EQ(4 * v + 6, sumOutput);
+    }
+
+    EXPECT_FALSE(nodes[0].IsHeavy());
+    EXPECT_TRUE(nodes[1].IsHeavy());
+}
+
+TEST(PropagationTest, Profiling)
+{
+    Group g;
+
+    auto in = StateVar<int>::Create(g, 0);
+    auto parity = State<int>::Create([] (int v) { return v % 2; }, in);
+
+    parity.SetName("parity");
+
+    auto obs = Observer::Create([] (int) { }, parity);
+
+    for (int v = 1; v <= 4; ++v)
+        in.Set(v);
+
+    std::vector<NodeProfile> profile = g.GetProfile();
+
+#ifdef REACT_ENABLE_PROFILING
+    auto it = std::find_if(profile.begin(), profile.end(), [] (const NodeProfile& p) { return p.name == "parity"; });
+    ASSERT_NE(profile.end(), it);
+
+    EXPECT_EQ(4u, it->updateCount);
+    EXPECT_EQ(4u, it->changedCount);
+    EXPECT_EQ(0u, it->unchangedCount);
+    EXPECT_EQ(0u, it->shiftedCount);
+
+    in.Set(6);
+
+    profile = g.GetProfile();
+    it = std::find_if(profile.begin(), profile.end(), [] (const NodeProfile& p) { return p.name == "parity"; });
+    ASSERT_NE(profile.end(), it);
+    EXPECT_EQ(1u, it->unchangedCount);
+
+    g.ResetProfile();
+
+    profile = g.GetProfile();
+    for (const NodeProfile& p : profile)
+        EXPECT_EQ(0u, p.updateCount);
+#else
+    EXPECT_TRUE(profile.empty());
+#endif
+}
+
+TEST(PropagationTest, Tracing)
+{
+    Group g;
+    g.SetPropagationMode(PropagationMode::level_parallel);
+
+    auto in = StateVar<int>::Create(g, 0);
+    auto twice = State<int>::Create([] (int v) { return v * 2; }, in);
+
+    twice.SetName("twice \"quoted\"");
+
+    int output = 0;
+    auto obs = Observer::Create([&] (int v) { output = v; }, twice);
+
+    g.StartTrace();
+
+    in.Set(1);
+    in.Set(2);
+
+    std::ostringstream out;
+    g.StopTrace(out);
+
+    std::string trace = out.str();
+
+    EXPECT_EQ(0u, trace.find("{\"traceEvents\":["));
+
+#ifdef REACT_ENABLE_PROFILING
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"turn\""));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"level\""));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"observer\""));
+    EXPECT_NE(std::string::npos, trace.find("\"label\":\"twice \\\"quoted\\\"\""));
+
+    // Nothing is recorded after the trace has been stopped.
+    in.Set(3);
+
+    std::ostringstream out2;
+    g.StopTrace(out2);
+    EXPECT_EQ(std::string::npos, out2.str().find("\"name\":\"turn\""));
+#endif
+}
+
+TEST(PropagationTest, Sequential)
+{
+    TestWideGraph(PropagationMode::sequential);
+    TestDynamicGraph(PropagationMode::sequential);
+    TestAutomaticWeights(PropagationMode::sequential);
+}
+
+TEST(PropagationTest, LevelParallel)
+{
+    TestWideGraph(PropagationMode::level_parallel);
+    TestDynamicGraph(PropagationMode::level_parallel);
+    TestAutomaticWeights(PropagationMode::level_parallel);
+}
+
+TEST(PropagationTest, Pulsecount)
+{
+    TestWideGraph(PropagationMode::pulsecount);
+    TestDynamicGraph(PropagationMode::pulsecount);
+    TestAutomaticWeights(PropagationMode::pulsecount);
+}
+
+TEST(PropagationTest, Subtree)
+{
+    TestWideGraph(PropagationMode::subtree);
+    TestDynamicGraph(PropagationMode::subtree);
+    TestAutomaticWeights(PropagationMode::subtree);
+}
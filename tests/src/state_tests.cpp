@@ -9,8 +9,10 @@
 #include "react/state.h"
 #include "react/observer.h"
 
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <memory>
 
 using namespace react;
 
@@ -202,6 +204,53 @@ TEST(StateTest, Links)
     std::this_thread::sleep_for(std::chrono::seconds(1));
 }
 
+TEST(StateTest, LinkCoalescing)
+{
+    Group g1;
+    Group g2;
+
+    g2.SetStateLinkCoalescingEnabled(true);
+
+    auto st = StateVar<int>::Create(g1, 0);
+    auto lnk = StateLink<int>::Create(g2, st);
+
+    int output = 0;
+    int turns = 0;
+
+    auto obs = Observer::Create([&] (const auto& v)
+        {
+            ++turns;
+            output = v;
+        }, lnk);
+
+    EXPECT_EQ(1, turns);
+
+    // Keep the target busy, so link updates pile up.
+    std::atomic<bool> isBlocked{ true };
+
+    g2.EnqueueTransaction([&]
+        {
+            while (isBlocked)
+                std::this_thread::yield();
+        });
+
+    for (int i = 1; i <= 100; ++i)
+        st.Set(i);
+
+    isBlocked = false;
+    g2.WaitIdle();
+
+    // Only the latest value is applied.
+    EXPECT_EQ(100, output);
+    EXPECT_EQ(2, turns);
+
+    st.Set(200);
+    g2.WaitIdle();
+
+    EXPECT_EQ(200, output);
+    EXPECT_EQ(3, turns);
+}
+
 namespace
 {
 
@@ -219,6 +268,46 @@ static T Sum3(T a, T b, T c)
 
 } // ~namespace
 
+TEST(StateTest, LazyEvaluation)
+{
+    Group g;
+
+    auto a = StateVar<int>::Create(g, 1);
+    auto b = StateVar<int>::Create(g, 2);
+
+    int evalCount = 0;
+
+    auto lazy1 = State<int>::CreateLazy([&] (int x, int y) { ++evalCount; return x + y; }, a, b);
+    auto lazy2 = State<int>::CreateLazy([&] (int x) { ++evalCount; return x * 10; }, lazy1);
+
+    // Nothing reads the values yet.
+    a.Set(10);
+    b.Set(20);
+    EXPECT_EQ(0, evalCount);
+
+    // Eager successors compute the whole chain on demand.
+    auto eager = State<int>::Create([] (int x, int y) { return x + y; }, lazy2, b);
+    EXPECT_EQ(2, evalCount);
+
+    int output = 0;
+    auto obs = Observer::Create([&] (int v) { output = v; }, eager);
+    EXPECT_EQ(320, output);
+    EXPECT_EQ(2, evalCount);
+
+    // Each lazy node is evaluated once per change.
+    a.Set(100);
+    EXPECT_EQ(1220, output);
+    EXPECT_EQ(4, evalCount);
+
+    g.DoTransaction([&]
+        {
+            a.Set(1);
+            b.Set(2);
+        });
+    EXPECT_EQ(32, output);
+    EXPECT_EQ(6, evalCount);
+}
+
 TEST(StateTest, StateCombination1)
 {
     Group g;
@@ -424,3 +513,25 @@ TEST(StateTest, Modify3)
 
     ASSERT_EQ(turns, 2);
 }
+
+TEST(StateTest, Modify4)
+{
+    Group g;
+
+    int result = 0;
+
+    auto var = StateVar<int>::Create(g, 0);
+
+    auto obs = Observer::Create([&] (int v) { result = v; }, var);
+
+    // Mutable and move-only callables.
+    int calls = 0;
+    var.Modify([calls] (int& v) mutable { v = ++calls; });
+
+    EXPECT_EQ(1, result);
+
+    auto p = std::make_unique<int>(10);
+    var.Modify([p = std::move(p)] (int& v) { v = *p; });
+
+    EXPECT_EQ(10, result);
+}
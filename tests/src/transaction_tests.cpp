@@ -10,8 +10,11 @@
 #include "react/event.h"
 #include "react/observer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 using namespace react;
 
@@ -69,6 +72,750 @@ TEST(TransactionTest, Merging)
     EXPECT_EQ(21, output);
 }
 
+TEST(TransactionTest, Stats)
+{
+    Group g;
+
+    auto evt = EventSource<int>::Create(g);
+
+    // Blocks the queue, so the following transactions are merged.
+    g.EnqueueTransaction([&]
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        });
+
+    SyncPoint sp;
+
+    for (int i = 0; i < 3; ++i)
+        g.EnqueueTransaction([&, i] { evt.Emit(i); }, sp, TransactionFlags::allow_merging);
+
+    bool done = sp.WaitFor(std::chrono::seconds(3));
+    EXPECT_EQ(true, done);
+
+    // The stats of a turn are recorded right after its sync point has been released.
+    TransactionStats stats;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        stats = g.GetTransactionStats();
+        if (stats.mergeBatchSize.sum == 4)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    EXPECT_EQ(4u, stats.enqueueLatency.count);
+    EXPECT_EQ(4u, stats.queueDepth.count);
+    EXPECT_LE(3u, stats.queueDepth.max);
+
+    // Two turns: The blocking one and the merged one.
+    EXPECT_EQ(2u, stats.executionTime.count);
+    EXPECT_EQ(2u, stats.mergeBatchSize.count);
+    EXPECT_EQ(1u, stats.mergeBatchSize.min);
+    EXPECT_EQ(3u, stats.mergeBatchSize.max);
+
+    // Merged transactions had to wait for the blocking one.
+    EXPECT_LE(100000000u, stats.enqueueLatency.max);
+    EXPECT_LE(100000000u, stats.executionTime.max);
+
+    g.ResetTransactionStats();
+    EXPECT_EQ(0u, g.GetTransactionStats().executionTime.count);
+}
+
+TEST(TransactionTest, ConcurrentInput)
+{
+    Group g;
+    g.SetConcurrentInputEnabled(true);
+
+    auto evt = EventSource<int>::Create(g);
+    auto counter = StateVar<int>::Create(g, 0);
+
+    std::vector<int> values;
+    int lastCounter = 0;
+
+    auto obs1 = Observer::Create([&] (const auto& events)
+        {
+            for (int e : events)
+                values.push_back(e);
+        }, evt);
+
+    auto obs2 = Observer::Create([&] (int v) { lastCounter = v; }, counter);
+
+    const int thread_count = 4;
+    const int emit_count = 10000;
+
+    std::vector<std::thread> threads;
+
+    // Each thread emits its own range of values.
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&, t]
+            {
+                for (int i = 1; i <= emit_count; ++i)
+                {
+                    evt.Emit(t * emit_count + i);
+                    counter.Modify([] (int& v) { ++v; });
+                }
+            });
+    }
+
+    // Enqueued transactions are serialized with direct inputs.
+    SyncPoint sp;
+    g.EnqueueTransaction([&] { evt.Emit(0); }, sp);
+
+    for (auto& t : threads)
+        t.join();
+
+    sp.Wait();
+
+    // Waits for the owner to release the graph, which then drains what's left in the input buffer.
+    g.DoTransaction([] { });
+
+    EXPECT_EQ(thread_count * emit_count, lastCounter);
+
+    // The inputs of each thread arrive in the order they were emitted.
+    std::vector<int> lastOfThread(thread_count, 0);
+
+    for (int v : values)
+    {
+        if (v == 0)
+            continue;
+
+        int t = (v - 1) / emit_count;
+        EXPECT_LT(lastOfThread[t], v);
+        lastOfThread[t] = v;
+    }
+
+    // Nothing has been lost or duplicated.
+    std::sort(values.begin(), values.end());
+
+    ASSERT_EQ(size_t(thread_count * emit_count + 1), values.size());
+
+    for (int i = 0; i <= thread_count * emit_count; ++i)
+        EXPECT_EQ(i, values[i]);
+}
+
+TEST(TransactionTest, ConcurrentInputBuffering)
+{
+    Group g;
+    g.SetConcurrentInputEnabled(true);
+
+    auto evt = EventSource<int>::Create(g);
+    auto counter = StateVar<int>::Create(g, 0);
+
+    std::vector<std::vector<int>> turnValues;
+    int lastCounter = 0;
+
+    std::atomic<bool> isStarted{ false };
+    std::atomic<bool> isReleased{ false };
+
+    auto obs1 = Observer::Create([&] (const auto& events)
+        {
+            turnValues.emplace_back(events.begin(), events.end());
+
+            // Holds the graph during the first turn, so other inputs have to be buffered.
+            if (! isStarted)
+            {
+                isStarted = true;
+                while (! isReleased)
+                    std::this_thread::yield();
+            }
+        }, evt);
+
+    auto obs2 = Observer::Create([&] (int v) { lastCounter = v; }, counter);
+
+    std::thread owner([&] { evt.Emit(1); });
+
+    while (! isStarted)
+        std::this_thread::yield();
+
+    // The graph is owned by the other thread, so these return right away.
+    evt.Emit(2);
+    evt.Emit(3);
+    counter.Modify([] (int& v) { v += 10; });
+
+    EXPECT_EQ(1u, turnValues.size());
+    EXPECT_EQ(0, lastCounter);
+
+    isReleased = true;
+    owner.join();
+
+    // The owner applied the buffered inputs in a single turn before it returned.
+    ASSERT_EQ(2u, turnValues.size());
+    EXPECT_EQ((std::vector<int>{ 1 }), turnValues[0]);
+    EXPECT_EQ((std::vector<int>{ 2, 3 }), turnValues[1]);
+    EXPECT_EQ(10, lastCounter);
+}
+
+TEST(TransactionTest, QueuePolicy)
+{
+    Group g;
+    g.SetTransactionQueueCapacity(4);
+    g.SetTransactionQueuePolicy(QueueFullPolicy::fail);
+
+    auto evt = EventSource<int>::Create(g);
+
+    int count = 0;
+    auto obs = Observer::Create([&] (const auto& events)
+        {
+            for (int e : events)
+                count += e;
+        }, evt);
+
+    // Keep the worker busy, so the following transactions pile up.
+    std::atomic<bool> isStarted{ false };
+    std::atomic<bool> isReleased{ false };
+
+    EXPECT_TRUE(g.EnqueueTransaction([&]
+        {
+            isStarted = true;
+            while (! isReleased)
+                std::this_thread::yield();
+            evt.Emit(1);
+        }));
+
+    while (! isStarted)
+        std::this_thread::yield();
+
+    int accepted = 0;
+
+    for (int i = 0; i < 8; ++i)
+        if (g.EnqueueTransaction([&] { evt.Emit(1); }))
+            ++accepted;
+
+    EXPECT_EQ(4, accepted);
+
+    // Only mergeable transactions are dropped.
+    g.SetTransactionQueuePolicy(QueueFullPolicy::drop_mergeable);
+    EXPECT_FALSE(g.EnqueueTransaction([&] { evt.Emit(1); }, TransactionFlags::allow_merging));
+
+    // Blocks until there's space.
+    g.SetTransactionQueuePolicy(QueueFullPolicy::block);
+
+    SyncPoint sp;
+    std::thread producer([&]
+        {
+            EXPECT_TRUE(g.EnqueueTransaction([&] { evt.Emit(1); }, sp));
+        });
+
+    isReleased = true;
+    producer.join();
+    sp.Wait();
+
+    EXPECT_EQ(6, count);
+}
+
+TEST(TransactionTest, LinkOverflow)
+{
+    Group g1;
+    Group g2;
+    g2.SetTransactionQueueCapacity(2);
+
+    auto evt1 = EventSource<int>::Create(g1);
+    Event<int> evt2 = Filter(g2, [] (const auto&) { return true; }, evt1);
+
+    std::vector<int> values;
+
+    auto obs = Observer::Create([&] (const auto& events)
+        {
+            for (int e : events)
+                values.push_back(e);
+        }, evt2);
+
+    // Keep the worker of g2 busy and fill its queue.
+    std::atomic<bool> isStarted{ false };
+    std::atomic<bool> isReleased{ false };
+
+    g2.EnqueueTransaction([&]
+        {
+            isStarted = true;
+            while (! isReleased)
+                std::this_thread::yield();
+        });
+
+    while (! isStarted)
+        std::this_thread::yield();
+
+    EXPECT_TRUE(g2.EnqueueTransaction([] { }));
+    EXPECT_TRUE(g2.EnqueueTransaction([] { }));
+
+    // The inputs of the link don't fit. They spill, so this thread doesn't wait for g2.
+    for (int i = 1; i <= 10; ++i)
+        evt1.Emit(i);
+
+    EXPECT_TRUE(values.empty());
+
+    isReleased = true;
+    g2.WaitIdle();
+
+    // Nothing has been lost, and the order is kept.
+    EXPECT_EQ((std::vector<int>{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }), values);
+}
+
+TEST(TransactionTest, Executors)
+{
+    Group g;
+
+    auto evt = EventSource<int>::Create(g);
+
+    int sum = 0;
+    std::thread::id observerThread;
+
+    auto obs = Observer::Create([&] (const auto& events)
+        {
+            observerThread = std::this_thread::get_id();
+            for (int e : events)
+                sum += e;
+        }, evt);
+
+    // Inline: the transaction is done once EnqueueTransaction returns.
+    g.SetExecutor(std::make_shared<InlineExecutor>());
+
+    g.EnqueueTransaction([&] { evt.Emit(1); });
+    EXPECT_EQ(1, sum);
+    EXPECT_EQ(std::this_thread::get_id(), observerThread);
+
+    // Thread pool: runs on a thread of the pool.
+    g.SetExecutor(std::make_shared<ThreadPoolExecutor>(2));
+
+    SyncPoint sp;
+
+    for (int i = 0; i < 10; ++i)
+        g.EnqueueTransaction([&] { evt.Emit(1); }, sp);
+
+    sp.Wait();
+
+    EXPECT_EQ(11, sum);
+    EXPECT_NE(std::this_thread::get_id(), observerThread);
+
+    // The last reference to a group may be released by an enqueued transaction.
+    {
+        auto pool = std::make_shared<ThreadPoolExecutor>(1);
+
+        std::atomic<bool> isDone{ false };
+
+        {
+            Group g2;
+            g2.SetExecutor(pool);
+
+            auto src = EventSource<int>::Create(g2);
+
+            g2.EnqueueTransaction([src] () mutable { src.Emit(1); });
+        }
+
+        // Runs after the worker, which destroys the group once it returns.
+        pool->Post([&isDone] { isDone = true; });
+
+        while (! isDone)
+            std::this_thread::yield();
+    }
+
+    // The last reference to a pool may be released on one of its own threads.
+    {
+        auto pool = std::make_shared<ThreadPoolExecutor>(2);
+        auto* poolPtr = pool.get();
+
+        std::atomic<bool> isDone{ false };
+
+        poolPtr->Post([p = std::move(pool), &isDone] () mutable
+            {
+                p.reset();
+                isDone = true;
+            });
+
+        while (! isDone)
+            std::this_thread::yield();
+    }
+}
+
+TEST(TransactionTest, Priority)
+{
+    Group g;
+
+    auto evt = EventSource<int>::Create(g);
+
+    std::vector<int> order;
+    int turns = 0;
+
+    auto obs = Observer::Create([&] (const auto& events)
+        {
+            ++turns;
+            for (int e : events)
+                order.push_back(e);
+        }, evt);
+
+    // Keep the worker busy, so the following transactions pile up.
+    std::atomic<bool> isStarted{ false };
+    std::atomic<bool> isReleased{ false };
+
+    g.EnqueueTransaction([&]
+        {
+            isStarted = true;
+            while (! isReleased)
+                std::this_thread::yield();
+            evt.Emit(0);
+        });
+
+    while (! isStarted)
+        std::this_thread::yield();
+
+    SyncPoint sp;
+
+    g.EnqueueTransaction([&] { evt.Emit(1); }, sp, TransactionFlags::allow_merging | TransactionFlags::low_priority);
+    g.EnqueueTransaction([&] { evt.Emit(2); }, sp, TransactionFlags::allow_merging);
+    g.EnqueueTransaction([&] { evt.Emit(3); }, sp, TransactionFlags::allow_merging | TransactionFlags::high_priority);
+    g.EnqueueTransaction([&] { evt.Emit(4); }, sp, TransactionFlags::allow_merging | TransactionFlags::high_priority);
+
+    isReleased = true;
+    sp.Wait();
+
+    EXPECT_EQ((std::vector<int>{ 0, 3, 4, 2, 1 }), order);
+
+    // Only transactions of the same lane have been merged.
+    EXPECT_EQ(4, turns);
+}
+
+TEST(TransactionTest, Coalescing)
+{
+    Group g;
+
+    auto evt = EventSource<int>::Create(g);
+
+    int turns = 0;
+    auto obs = Observer::Create([&] (const auto& events) { ++turns; }, evt);
+
+    std::atomic<bool> isStarted{ false };
+    std::atomic<bool> isReleased{ false };
+
+    // Blocks the worker until released, so the following transactions pile up.
+    auto enqueueBlocker = [&]
+        {
+            isStarted = false;
+            isReleased = false;
+
+            g.EnqueueTransaction([&]
+                {
+                    isStarted = true;
+                    while (! isReleased)
+                        std::this_thread::yield();
+                    evt.Emit(0);
+                });
+
+            while (! isStarted)
+                std::this_thread::yield();
+        };
+
+    // Batches are limited to 3 transactions.
+    {
+        CoalescingPolicy policy;
+        policy.maxBatchSize = 3;
+        g.SetCoalescingPolicy(policy);
+
+        enqueueBlocker();
+
+        SyncPoint sp;
+        for (int i = 0; i < 7; ++i)
+            g.EnqueueTransaction([&] { evt.Emit(1); }, sp, TransactionFlags::allow_merging);
+
+        isReleased = true;
+        sp.Wait();
+
+        EXPECT_EQ(1 + 3, turns);
+    }
+
+    // The worker waits for the second transaction.
+    {
+        CoalescingPolicy policy;
+        policy.linger = std::chrono::seconds(1);
+        g.SetCoalescingPolicy(policy);
+
+        turns = 0;
+
+        SyncPoint sp;
+        g.EnqueueTransaction([&] { evt.Emit(1); }, sp, TransactionFlags::allow_merging);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        g.EnqueueTransaction([&] { evt.Emit(1); }, sp, TransactionFlags::allow_merging);
+
+        sp.Wait();
+
+        EXPECT_EQ(1, turns);
+    }
+
+    // Batches double in size each time they are filled: 1, 2, 4, 8, 1.
+    {
+        CoalescingPolicy policy;
+        policy.maxBatchSize = 8;
+        policy.isAdaptive = true;
+        g.SetCoalescingPolicy(policy);
+
+        turns = 0;
+
+        enqueueBlocker();
+
+        SyncPoint sp;
+        for (int i = 0; i < 16; ++i)
+            g.EnqueueTransaction([&] { evt.Emit(1); }, sp, TransactionFlags::allow_merging);
+
+        isReleased = true;
+        sp.Wait();
+
+        EXPECT_EQ(1 + 5, turns);
+    }
+
+    // Under light load, single transactions don't grow the batch, so they never linger.
+    {
+        CoalescingPolicy policy;
+        policy.maxBatchSize = 8;
+        policy.linger = std::chrono::seconds(1);
+        policy.isAdaptive = true;
+        g.SetCoalescingPolicy(policy);
+
+        turns = 0;
+
+        auto t0 = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < 4; ++i)
+            g.EnqueueTransaction([&] { evt.Emit(1); }, TransactionFlags::allow_merging).Wait();
+
+        auto elapsed = std::chrono::steady_clock::now() - t0;
+
+        EXPECT_EQ(4, turns);
+        EXPECT_GT(std::chrono::milliseconds(500), elapsed);
+    }
+}
+
+TEST(TransactionTest, Tickets)
+{
+    Group g;
+
+    auto evt = EventSource<int>::Create(g);
+
+    int sum = 0;
+    auto obs = Observer::Create([&] (const auto& events)
+        {
+            for (int e : events)
+                sum += e;
+        }, evt);
+
+    std::atomic<bool> isReleased{ false };
+
+    TransactionTicket t1 = g.EnqueueTransaction([&]
+        {
+            while (! isReleased)
+                std::this_thread::yield();
+            evt.Emit(1);
+        });
+
+    TransactionTicket t2 = g.EnqueueTransaction([&] { evt.Emit(2); }, TransactionFlags::low_priority);
+    TransactionTicket t3 = g.EnqueueTransaction([&] { evt.Emit(3); });
+
+    EXPECT_TRUE(t1.IsValid());
+    EXPECT_FALSE(t1.IsDone());
+    EXPECT_FALSE(t3.IsDone());
+
+    isReleased = true;
+
+    // Normal priority is done before low priority.
+    t3.Wait();
+    EXPECT_TRUE(t1.IsDone());
+
+    t2.Wait();
+    EXPECT_EQ(1 + 2 + 3, sum);
+
+    for (int i = 0; i < 100; ++i)
+        g.EnqueueTransaction([&] { evt.Emit(1); });
+
+    g.WaitIdle();
+    EXPECT_EQ(106, sum);
+
+    // Only waits for what was enqueued before, so it returns while another thread keeps going.
+    std::atomic<bool> isStopped{ false };
+
+    std::thread producer([&]
+        {
+            while (! isStopped)
+                g.EnqueueTransaction([] { });
+        });
+
+    for (int i = 0; i < 10; ++i)
+        g.EnqueueTransaction([&] { evt.Emit(1); });
+
+    g.WaitIdle();
+    EXPECT_EQ(116, sum);
+
+    isStopped = true;
+    producer.join();
+
+    // Rejected transactions have invalid tickets.
+    TransactionTicket rejected;
+    EXPECT_FALSE(rejected.IsValid());
+    EXPECT_FALSE(static_cast<bool>(rejected));
+}
+
+TEST(TransactionTest, GroupScheduler)
+{
+    // A single thread, so the groups have to take turns.
+    auto scheduler = std::make_shared<GroupScheduler>(1, std::chrono::milliseconds(1));
+
+    Group g1;
+    Group g2;
+
+    g1.SetExecutor(scheduler->CreateExecutor());
+    g2.SetExecutor(scheduler->CreateExecutor());
+
+    std::atomic<int> count1{ 0 };
+    int count1Before2 = -1;
+
+    for (int i = 0; i < 50; ++i)
+    {
+        g1.EnqueueTransaction([&]
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ++count1;
+            });
+    }
+
+    g2.EnqueueTransaction([&] { count1Before2 = count1; });
+
+    g1.WaitIdle();
+    g2.WaitIdle();
+
+    // The busy group yields after its time slice.
+    EXPECT_EQ(50, count1);
+    EXPECT_LE(0, count1Before2);
+    EXPECT_GT(50, count1Before2);
+
+    // Lingering for merges doesn't keep the thread past the time slice.
+    {
+        CoalescingPolicy policy;
+        policy.linger = std::chrono::seconds(1);
+        g1.SetCoalescingPolicy(policy);
+
+        count1 = 0;
+        count1Before2 = -1;
+
+        for (int i = 0; i < 50; ++i)
+        {
+            g1.EnqueueTransaction([&]
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    ++count1;
+                });
+        }
+
+        g2.EnqueueTransaction([&] { count1Before2 = count1; });
+
+        g1.WaitIdle();
+        g2.WaitIdle();
+
+        EXPECT_EQ(50, count1);
+        EXPECT_LE(0, count1Before2);
+        EXPECT_GT(50, count1Before2);
+    }
+
+    // Many groups share a few threads.
+    auto pool = std::make_shared<GroupScheduler>(4, std::chrono::microseconds(100));
+
+    const int groupCount = 16;
+
+    std::vector<Group> groups;
+    std::vector<EventSource<int>> sources;
+    std::vector<Observer> observers;
+    std::vector<int> sums(groupCount, 0);
+
+    for (int i = 0; i < groupCount; ++i)
+    {
+        groups.emplace_back();
+        groups.back().SetExecutor(pool->CreateExecutor());
+
+        sources.push_back(EventSource<int>::Create(groups.back()));
+
+        observers.push_back(Observer::Create([&sums, i] (const auto& events)
+            {
+                for (int e : events)
+                    sums[i] += e;
+            }, sources.back()));
+    }
+
+    for (int k = 0; k < 100; ++k)
+        for (int i = 0; i < groupCount; ++i)
+            groups[i].EnqueueTransaction([src = sources[i]] () mutable { src.Emit(1); });
+
+    for (auto& g : groups)
+        g.WaitIdle();
+
+    for (int i = 0; i < groupCount; ++i)
+        EXPECT_EQ(100, sums[i]);
+
+    // Releasing the last executor on a scheduler thread destroys the scheduler there.
+    {
+        auto executor = std::make_shared<GroupScheduler>(2)->CreateExecutor();
+        auto* executorPtr = executor.get();
+
+        std::atomic<bool> isDone{ false };
+
+        executorPtr->Post([e = std::move(executor), &isDone] () mutable
+            {
+                e.reset();
+                isDone = true;
+            });
+
+        while (! isDone)
+            std::this_thread::yield();
+    }
+}
+
+TEST(TransactionTest, CallerRuns)
+{
+    Group g;
+
+    g.SetCallerRunsEnabled(true);
+
+    auto evt = EventSource<int>::Create(g);
+
+    int sum = 0;
+    std::thread::id observerThread;
+
+    auto obs = Observer::Create([&] (const auto& events)
+        {
+            observerThread = std::this_thread::get_id();
+            for (int e : events)
+                sum += e;
+        }, evt);
+
+    // Idle queue: the caller runs the transaction.
+    auto ticket = g.EnqueueTransaction([&] { evt.Emit(1); });
+
+    EXPECT_TRUE(ticket.IsDone());
+    EXPECT_EQ(1, sum);
+    EXPECT_EQ(std::this_thread::get_id(), observerThread);
+
+    // Asked not to block: handed to the worker.
+    std::atomic<bool> isStarted{ false };
+    std::atomic<bool> isReleased{ false };
+
+    g.EnqueueTransaction([&]
+        {
+            isStarted = true;
+            while (! isReleased)
+                std::this_thread::yield();
+            evt.Emit(1);
+        }, TransactionFlags::non_blocking);
+
+    while (! isStarted)
+        std::this_thread::yield();
+
+    // Busy queue: queued as usual.
+    ticket = g.EnqueueTransaction([&] { evt.Emit(1); });
+
+    EXPECT_FALSE(ticket.IsDone());
+
+    isReleased = true;
+    ticket.Wait();
+
+    EXPECT_EQ(3, sum);
+    EXPECT_NE(std::this_thread::get_id(), observerThread);
+}
+
 TEST(TransactionTest, LinkedSync)
 {
     // Three groups. Each has one event with an observer attached.